@@ -0,0 +1,50 @@
+#ifndef WAGNER_BENCH_HH_
+#define WAGNER_BENCH_HH_
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cmath>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+
+namespace bench {
+
+using clk = std::chrono::steady_clock;
+
+/** Milliseconds elapsed since 'start'. */
+inline auto ms_since(clk::time_point start) -> double {
+  return std::chrono::duration<double, std::milli>(clk::now() - start).count();
+}
+
+/** A landscape of 'communities' vertices with about 10 neighbors each. */
+inline auto landscape(size_t communities, std::mt19937_64 &rng) -> wagner::network<wagner::point> {
+  auto net = wagner::network<wagner::point>{};
+  net.rgg(communities, std::sqrt(10.0 / (math_pi * communities)), rng);
+  return net;
+}
+
+/** Spread 'nspecies' species over the landscape, each with 'range' populations. */
+inline auto populate(wagner::speciestree &tree,
+                     wagner::network<wagner::point> const& landscape,
+                     size_t nspecies, size_t range, std::mt19937_64 &rng) -> void {
+  std::vector<wagner::species*> tips(tree.begin(), tree.end());
+  std::uniform_int_distribution<size_t> pick;
+  while (tips.size() < nspecies) {
+    auto parent = tips[pick(rng) % tips.size()];
+    tips.push_back(tree.speciate(parent, tips.size()));
+  }
+  for (auto sp : tips) {
+    for (auto i = 0u; i < range; ++i) {
+      sp->add_to(landscape.random_vertex(rng));
+    }
+  }
+}
+
+}
+
+#endif
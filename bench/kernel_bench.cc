@@ -0,0 +1,98 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/migration.hh"
+#include "wagner/model.hh"
+#include "bench.hh"
+
+// The migration phase before it was specialized: the model is tested at
+// run time in the innermost loop.
+static auto migration_dynamic(wagner::model m, wagner::speciestree &tree,
+                              wagner::network<wagner::point> const& landscape,
+                              size_t t, double mig_max, double aleph,
+                              std::mt19937_64 &rng) -> size_t {
+  std::uniform_real_distribution<> unif;
+  std::vector<wagner::vertex> sources;
+  size_t new_pops = 0;
+  for (auto s0 : tree) {
+    sources.assign(s0->get_locations().begin(), s0->get_locations().end());
+    for (auto const& source : sources) {
+      for (auto location : landscape.neighbors(source)) {
+        if (s0->is_in(location)) continue;
+        double mig = mig_max;
+        if (m != wagner::model::neutral) {
+          double delta = 0.0;
+          for (auto s1 : tree.residents(location)) {
+            if (m == wagner::model::euclidean_traits) {
+              delta += 1.0 - tree.distance(*s0, *s1);
+            } else if (m == wagner::model::phylo_dist) {
+              delta += 1.0 / (t - tree.mrca(*s0, *s1));
+              break;
+            } else if (m == wagner::model::fuzzy_traits) {
+              const auto prox = 1.0 - tree.distance(*s0, *s1);
+              if (prox > delta) delta = prox;
+            }
+          }
+          mig *= (m == wagner::model::fuzzy_traits? 1.0 - delta : exp(-aleph * delta));
+        }
+        if (unif(rng) < mig) {
+          s0->add_to(location);
+          ++new_pops;
+        }
+      }
+    }
+  }
+  return new_pops;
+}
+
+// Best of 'reps' migration passes, each on a freshly populated landscape.
+template<typename F>
+static auto time_pass(size_t communities, size_t reps, F&& pass) -> double {
+  double best = 1e300;
+  for (auto r = 0u; r < reps; ++r) {
+    auto rng = std::mt19937_64{42 + r};
+    auto const landscape = bench::landscape(communities, rng);
+    wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 10, 0.5f)};
+    bench::populate(tree, landscape, communities / 4, 64, rng);
+    tree.update_distances();
+    tree.mrca(**tree.begin(), **tree.begin());
+
+    auto const start = bench::clk::now();
+    pass(tree, landscape, rng);
+    best = min2(best, bench::ms_since(start));
+  }
+  return best;
+}
+
+template<wagner::model m>
+static auto compare(size_t communities, size_t reps) -> void {
+  double const mig_max = 0.04, aleph = 10.0;
+  size_t const t = 1u << 20;
+  auto const dynamic = time_pass(communities, reps,
+    [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+      migration_dynamic(m, tree, l, t, mig_max, aleph, rng);
+    });
+  auto const specialized = time_pass(communities, reps,
+    [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+      wagner::migration<m>(tree, l, t, mig_max, aleph, rng);
+    });
+  std::cout << m << "  " << dynamic << "  " << specialized << "  "
+            << dynamic / specialized << '\n';
+}
+
+auto main() -> int {
+  size_t const communities = 2048, reps = 5;
+  std::cout << "model  dynamic (ms)  specialized (ms)  speedup\n";
+  compare<wagner::model::neutral>(communities, reps);
+  compare<wagner::model::phylo_dist>(communities, reps);
+  compare<wagner::model::euclidean_traits>(communities, reps);
+  compare<wagner::model::fuzzy_traits>(communities, reps);
+  return 0;
+}
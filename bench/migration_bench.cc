@@ -0,0 +1,146 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/migration.hh"
+#include "wagner/model.hh"
+#include "bench.hh"
+
+// The migration phase as it was before the occupancy index: every candidate
+// location scans all the species of the tree.
+static auto migration_scan(wagner::speciestree &tree,
+                           wagner::network<wagner::point> const& landscape,
+                           double mig_max, double aleph,
+                           std::mt19937_64 &rng) -> size_t {
+  std::uniform_real_distribution<> unif;
+  std::vector<wagner::vertex> sources;
+  size_t new_pops = 0;
+  for (auto s0 : tree) {
+    sources.assign(s0->get_locations().begin(), s0->get_locations().end());
+    for (auto const& source : sources) {
+      for (auto location : landscape.neighbors(source)) {
+        if (s0->is_in(location)) continue;
+        double delta = 0.0;
+        for (auto s1 : tree) {
+          if (s1 != s0 && s1->is_in(location)) {
+            delta += 1.0 - wagner::euclidean_distance(s0->traits(), s1->traits());
+          }
+        }
+        if (unif(rng) < mig_max * exp(-aleph * delta)) {
+          s0->add_to(location);
+          ++new_pops;
+        }
+      }
+    }
+  }
+  return new_pops;
+}
+
+template<typename F>
+static auto time_pass(size_t communities, F&& pass, size_t range = 16) -> double {
+  auto rng = std::mt19937_64{42};
+  auto const landscape = bench::landscape(communities, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 10, 0.5f)};
+  bench::populate(tree, landscape, communities / 4, range, rng);
+  tree.update_distances();
+
+  auto const start = bench::clk::now();
+  pass(tree, landscape, rng);
+  return bench::ms_since(start);
+}
+
+// A pass on contiguous ranges: each species holds the 256 communities closest
+// (in hops) to a random one, on a landscape of about 'degree' neighbors.
+template<typename F>
+static auto time_ranges(size_t communities, double degree, F&& pass) -> double {
+  auto rng = std::mt19937_64{42};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(communities, std::sqrt(degree / (math_pi * communities)), rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 10, 0.5f)};
+  bench::populate(tree, landscape, communities / 64, 0, rng);
+  std::vector<wagner::vertex> queue;
+  for (auto sp : tree) {
+    queue.assign(1, landscape.random_vertex(rng));
+    sp->add_to(queue[0]);
+    for (size_t i = 0; i < queue.size() && sp->size() < 256; ++i) {
+      for (auto w : landscape.neighbors(queue[i])) {
+        if (!sp->is_in(w) && sp->size() < 256) {
+          sp->add_to(w);
+          queue.push_back(w);
+        }
+      }
+    }
+  }
+  tree.update_distances();
+
+  auto const start = bench::clk::now();
+  pass(tree, landscape, rng);
+  return bench::ms_since(start);
+}
+
+auto main() -> int {
+  double const mig_max = 0.04, aleph = 10.0;
+  std::cout << "communities  species  scan (ms)  index (ms)  speedup\n";
+  for (size_t communities : {256, 1024, 4096}) {
+    auto const scan = time_pass(communities,
+      [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+        migration_scan(tree, l, mig_max, aleph, rng);
+      });
+    auto const index = time_pass(communities,
+      [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+        wagner::migration<wagner::model::euclidean_traits>(tree, l, 1, mig_max, aleph, rng);
+      });
+    std::cout << communities << "  " << communities / 4 << "  " << scan << "  "
+              << index << "  " << scan / index << '\n';
+  }
+
+  // The synchronous phase scales with the threads up to the number of cores.
+  auto const threads = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "\ncommunities  sequential (ms)  synchronous (ms) with 1, 2, 4... threads ("
+            << threads << " cores)\n";
+  for (size_t communities : {4096, 16384, 65536}) {
+    std::cout << communities << "  " << time_pass(communities,
+      [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+        wagner::migration<wagner::model::euclidean_traits>(tree, l, 1, mig_max, aleph, rng);
+      }, 64);
+    for (size_t n = 1; n <= threads; n *= 2) {
+      wagner::synchronous_migration phase(n, 42);
+      std::cout << "  " << time_pass(communities,
+        [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64&) {
+          phase.run<wagner::model::euclidean_traits>(tree, l, 1, mig_max, aleph);
+        }, 64);
+    }
+    std::cout << '\n';
+  }
+
+  // One draw per target instead of one per trial: the denser the landscape,
+  // the more populations of a contiguous range share a target, and the rate
+  // to a target is computed once.
+  std::cout << "\nneighbors  per trial / per target (ms), neutral then euclidean traits"
+               " (16384 communities)\n";
+  for (double degree : {10.0, 40.0, 160.0}) {
+    std::cout << degree;
+    for (auto draws : {wagner::migration_draws::per_trial, wagner::migration_draws::per_target}) {
+      std::cout << "  " << time_ranges(16384, degree,
+        [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+          wagner::migration<wagner::model::neutral>(tree, l, 1, mig_max, aleph, rng, draws);
+        });
+    }
+    for (auto draws : {wagner::migration_draws::per_trial, wagner::migration_draws::per_target}) {
+      std::cout << "  " << time_ranges(16384, degree,
+        [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+          wagner::migration<wagner::model::euclidean_traits>(tree, l, 1, mig_max, aleph, rng, draws);
+        });
+    }
+    std::cout << '\n';
+  }
+  return 0;
+}
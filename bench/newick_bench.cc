@@ -0,0 +1,69 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "wagner/common.hh"
+#include "wagner/tbranch.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "bench.hh"
+
+// The former writer: recursive, one string per node.
+static auto recursive_newick(const wagner::tbranch *t) -> std::string {
+  std::ostringstream o;
+  if (t->leaf()) {
+    o << "species" << static_cast<const wagner::species*>(t)->id << ':' << t->parent_distance();
+  } else {
+    o << "(" << recursive_newick(t->left()) << "," << recursive_newick(t->right())
+      << "):" << t->parent_distance();
+    if (t->root()) o << ";";
+  }
+  return o.str();
+}
+
+// A tree of 'tips' species, grown by speciating random tips (or always the
+// newest one for a caterpillar).
+static auto grow(wagner::speciestree &tree, size_t tips, bool caterpillar) -> void {
+  auto rng = std::mt19937_64{42};
+  std::vector<wagner::species*> ss(tree.begin(), tree.end());
+  for (size_t t = 1; ss.size() < tips; ++t) {
+    ss.push_back(tree.speciate(caterpillar ? ss.back() : ss[rng() % ss.size()], t));
+  }
+  tree.stop(tips);
+}
+
+auto main() -> int {
+  size_t const tips = 100000;
+  std::cout << "tree (" << tips << " tips)  recursive / iterative string / iterative to file (ms)\n";
+  for (auto caterpillar : {false, true}) {
+    wagner::speciestree tree{std::vector<float>{}};
+    grow(tree, tips, caterpillar);
+    std::cout << (caterpillar ? "caterpillar" : "random") << "  ";
+
+    // The recursive writer overflows the stack on the caterpillar.
+    if (!caterpillar) {
+      const wagner::tbranch *root = *tree.begin();
+      while (root->parent() != nullptr) root = root->parent();
+      auto const t0 = bench::clk::now();
+      auto const s = recursive_newick(root);
+      std::cout << bench::ms_since(t0) << " (" << s.size() << " chars) / ";
+    } else {
+      std::cout << "- / ";
+    }
+
+    auto const t1 = bench::clk::now();
+    auto const s = tree.newick();
+    std::cout << bench::ms_since(t1) << " (" << s.size() << " chars) / ";
+
+    std::ofstream out("newick_bench.tre");
+    auto const t2 = bench::clk::now();
+    out << tree << '\n';
+    out.flush();
+    std::cout << bench::ms_since(t2) << '\n';
+  }
+  std::remove("newick_bench.tre");
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include "wagner/common.hh"
+#include "wagner/range.hh"
+#include "bench.hh"
+
+// Fill 'nspecies' ranges with 'pops' random populations each on a landscape of
+// 'communities' vertices, then time presence tests, iteration and co-occurrence.
+template<typename R>
+static auto run(const char *name, size_t communities, size_t nspecies, size_t pops) -> void {
+  auto rng = std::mt19937_64{42};
+  auto ranges = std::vector<R>(nspecies);
+  auto start = bench::clk::now();
+  for (auto &r : ranges) {
+    for (auto i = 0u; i < pops; ++i) r.insert(rng() % communities);
+  }
+  auto const t_insert = bench::ms_since(start);
+
+  size_t hits = 0;
+  start = bench::clk::now();
+  for (auto &r : ranges) {
+    for (auto i = 0u; i < 1000; ++i) hits += r.contains(rng() % communities);
+  }
+  auto const t_contains = bench::ms_since(start);
+
+  size_t sum = 0;
+  start = bench::clk::now();
+  for (auto const& r : ranges) {
+    for (auto v : r) sum += v;
+  }
+  auto const t_iterate = bench::ms_since(start);
+
+  size_t common = 0;
+  start = bench::clk::now();
+  for (size_t i = 0; i + 1 < ranges.size(); ++i) common += ranges[i].common(ranges[i + 1]);
+  auto const t_common = bench::ms_since(start);
+
+  std::cout << name << "  " << communities << "  " << pops << "  " << t_insert
+            << "  " << t_contains << "  " << t_iterate << "  " << t_common
+            << "  (" << hits + sum + common << ")\n";
+}
+
+auto main() -> int {
+  std::cout << "layout  communities  pops/species  insert  contains  iterate  co-occurrence (ms)\n";
+  size_t const nspecies = 256;
+  for (size_t communities : {4096, 100000}) {
+    for (size_t pops : {communities / 100, communities / 4}) {
+      run<wagner::map_range>("map", communities, nspecies, pops);
+      run<wagner::bitset_range>("bitset", communities, nspecies, pops);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "bench.hh"
+
+using landscape_t = wagner::network<wagner::point>;
+
+// The former construction: every pair of vertices is compared.
+static auto rgg_all_pairs(size_t order, double radius, std::mt19937_64 &rng) -> landscape_t {
+  std::uniform_real_distribution<> unif;
+  auto vs = std::vector<wagner::point>{};
+  for (size_t i = 0; i < order; ++i) {
+    wagner::point p(unif(rng), unif(rng));
+    vs.push_back(p);
+  }
+  std::sort(vs.begin(), vs.end());
+  vs.erase(std::unique(vs.begin(), vs.end()), vs.end());
+  auto edges = std::vector<std::pair<wagner::vertex, wagner::vertex>>{};
+  for (wagner::vertex i = 0; i < vs.size(); ++i) {
+    for (wagner::vertex j = i + 1; j < vs.size(); ++j) {
+      if (euclidean_distance(vs[i], vs[j]) < radius) {
+        edges.emplace_back(i, j);
+        edges.emplace_back(j, i);
+      }
+    }
+  }
+  return landscape_t(std::move(vs), std::move(edges));
+}
+
+auto main() -> int {
+  std::cout << "communities  radius  edges  all pairs (ms)  grid (ms)\n";
+  for (size_t communities : {1000, 10000, 100000}) {
+    // About 10 neighbors per community.
+    double const radius = std::sqrt(10.0 / (math_pi * communities));
+    auto rng = std::mt19937_64{42};
+    auto start = bench::clk::now();
+    auto net = landscape_t{};
+    net.rgg(communities, radius, rng);
+    auto const grid = bench::ms_since(start);
+
+    std::cout << communities << "  " << radius << "  " << net.size() << "  ";
+    if (communities <= 10000) {
+      rng.seed(42);
+      start = bench::clk::now();
+      auto const old = rgg_all_pairs(communities, radius, rng);
+      std::cout << bench::ms_since(start) << (old.size() == net.size() ? "" : " (mismatch)");
+    } else {
+      std::cout << "-";
+    }
+    std::cout << "  " << grid << '\n';
+  }
+  return 0;
+}
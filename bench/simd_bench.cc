@@ -0,0 +1,69 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include "wagner/simd.hh"
+#include "bench.hh"
+
+// The former kernel: a sequential scalar loop.
+static auto scalar_distance(const float *xs, const float *ys, size_t n) -> float {
+  float sum = 0.0f;
+  for (size_t i = 0; i < n; ++i) {
+    float const sub = xs[i] - ys[i];
+    sum += sub * sub;
+  }
+  return std::sqrt(sum);
+}
+
+auto main() -> int {
+  size_t const rows = 512, reps = 20;
+  auto rng = std::mt19937_64{42};
+  auto unif = std::uniform_real_distribution<float>{-0.5f, 0.5f};
+  std::cout << "simd: " << wagner::simd::isa() << '\n'
+            << "traits  scalar / pairwise / one vs many (ns per distance)\n";
+  for (size_t n = 2; n <= 256; n *= 2) {
+    size_t const stride = (n + 15) / 16 * 16;
+    auto base = std::vector<float>(rows * stride, 0.0f);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t i = 0; i < n; ++i) base[r * stride + i] = unif(rng);
+    }
+    auto slots = std::vector<size_t>(rows);
+    for (size_t r = 0; r < rows; ++r) slots[r] = r;
+    auto out = std::vector<float>(rows);
+    double const count = double(reps) * rows * rows;
+    float sink = 0.0f;
+
+    auto const t0 = bench::clk::now();
+    for (size_t k = 0; k < reps; ++k) {
+      for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < rows; ++j) {
+          sink += scalar_distance(&base[i * stride], &base[j * stride], n);
+        }
+      }
+    }
+    auto const scalar = bench::ms_since(t0);
+
+    auto const t1 = bench::clk::now();
+    for (size_t k = 0; k < reps; ++k) {
+      for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < rows; ++j) {
+          sink += wagner::euclidean_distance(&base[i * stride], &base[j * stride], n);
+        }
+      }
+    }
+    auto const pairwise = bench::ms_since(t1);
+
+    auto const t2 = bench::clk::now();
+    for (size_t k = 0; k < reps; ++k) {
+      for (size_t i = 0; i < rows; ++i) {
+        wagner::simd::distances(&base[i * stride], base.data(), stride,
+                                slots.data(), rows, stride, out.data());
+        sink += out[i];
+      }
+    }
+    auto const batched = bench::ms_since(t2);
+
+    std::cout << n << "  " << scalar * 1e6 / count << " / " << pairwise * 1e6 / count
+              << " / " << batched * 1e6 / count << (sink == 0.0f ? " " : "") << '\n';
+  }
+}
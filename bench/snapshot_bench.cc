@@ -0,0 +1,43 @@
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include "wagner/common.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/snapshot.hh"
+#include "bench.hh"
+
+// Time the simulation thread spends on one w-species file: formatting and
+// writing it (as before), or only copying the tree (the writer thread does
+// the rest).
+auto main() -> int {
+  auto rng = std::mt19937_64{42};
+  std::cout << "species x range  synchronous write / capture (ms)\n";
+  for (size_t nspecies : {100, 1000}) {
+    auto landscape = bench::landscape(4096, rng);
+    wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 10, 0.5f)};
+    bench::populate(tree, landscape, nspecies, 200, rng);
+    for (auto sp : tree) sp->up_groups(landscape);
+
+    auto const t0 = bench::clk::now();
+    {
+      std::ofstream out_res("w-species-bench.xml");
+      out_res << "<extant_species>\n";
+      out_res << "  <t>" << 1 << "</t>\n";
+      for (auto s0 : tree) out_res << "  " << s0->get_info(1, landscape) << '\n';
+      out_res << "</extant_species>\n";
+    }
+    auto const sync = bench::ms_since(t0);
+    std::remove("w-species-bench.xml");
+
+    wagner::snapshot snap;
+    snap.capture(tree, 1); // Warm up the buffers, as in a run.
+    auto const t1 = bench::clk::now();
+    snap.capture(tree, 2);
+    auto const capture = bench::ms_since(t1);
+
+    std::cout << nspecies << " x 200  " << sync << " / " << capture << '\n';
+  }
+}
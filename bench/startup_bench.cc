@@ -0,0 +1,70 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "bench.hh"
+
+using landscape_t = wagner::network<wagner::point>;
+
+static auto visit(landscape_t const& net, std::vector<bool> &vs, wagner::vertex v) -> void {
+  for (auto i : net.neighbors(v)) {
+    if (!vs[i]) {
+      vs[i] = true;
+      visit(net, vs, i);
+    }
+  }
+}
+
+// The former test: a recursive depth-first search from every vertex.
+static auto connected_all_sources(landscape_t const& net) -> bool {
+  for (wagner::vertex i = 0; i < net.order(); ++i) {
+    auto vs = std::vector<bool>(net.order(), false);
+    vs[i] = true;
+    visit(net, vs, i);
+    for (auto j : vs) {
+      if (!j) return false;
+    }
+  }
+  return true;
+}
+
+// The start of a simulation: draw landscapes until one is connected. Returns
+// the total time, and the time spent testing connectivity in 'testing'.
+template<typename F>
+static auto startup(size_t communities, double radius, F&& connected,
+                    size_t &trials, double &testing) -> double {
+  auto rng = std::mt19937_64{42};
+  auto net = landscape_t{};
+  trials = 0;
+  testing = 0.0;
+  auto const start = bench::clk::now();
+  for (;;) {
+    ++trials;
+    net.rgg(communities, radius, rng);
+    auto const t0 = bench::clk::now();
+    auto const ok = connected(net);
+    testing += bench::ms_since(t0);
+    if (ok) break;
+  }
+  return bench::ms_since(start);
+}
+
+auto main() -> int {
+  std::cout << "communities  radius  trials  startup: all-sources DFS / BFS (ms)"
+               "  connectivity tests: all-sources DFS / BFS (ms)\n";
+  for (size_t communities : {1024, 2048, 4096}) {
+    // Sparse landscapes, around the connectivity threshold.
+    double const radius = std::sqrt(std::log((double)communities) / (math_pi * communities));
+    size_t trials = 0;
+    double test_old = 0.0, test_new = 0.0;
+    auto const old_ms = startup(communities, radius, connected_all_sources, trials, test_old);
+    auto const new_ms = startup(communities, radius,
+                                [](landscape_t const& n) { return n.connected(); }, trials, test_new);
+    std::cout << communities << "  " << radius << "  " << trials << "  " << old_ms
+              << " / " << new_ms << "  " << test_old << " / " << test_new << '\n';
+  }
+  return 0;
+}
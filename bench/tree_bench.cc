@@ -0,0 +1,45 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include "wagner/common.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "bench.hh"
+
+// A long run of the phylogeny alone: one speciation per step, and once the
+// tree holds 'extant' species, one extinction per step as well.
+static auto churn(size_t events, size_t extant) -> double {
+  auto rng = std::mt19937_64{42};
+  auto const start = bench::clk::now();
+  {
+    wagner::speciestree tree{std::vector<float>(4, 0.0f)};
+    std::vector<wagner::species*> tips(tree.begin(), tree.end());
+    tips[0]->add_to(0);
+    for (size_t t = 1; t <= events; ++t) {
+      auto s = tree.speciate(tips[rng() % tips.size()], t);
+      s->add_to(t % 64);
+      tips.push_back(s);
+      if (tips.size() > extant) {
+        auto const i = rng() % tips.size();
+        for (auto v : std::vector<wagner::vertex>(tips[i]->get_locations().begin(),
+                                                  tips[i]->get_locations().end())) {
+          tips[i]->rmv_from(v);
+        }
+        tips[i] = tips.back();
+        tips.pop_back();
+        tree.rmv_extinct(t);
+      }
+    }
+  }
+  return bench::ms_since(start);
+}
+
+auto main() -> int {
+  std::cout << "speciation events  extant species  time (ms)\n";
+  for (size_t events : {10000, 100000}) {
+    for (size_t extant : {100, 1000}) {
+      std::cout << events << "  " << extant << "  " << churn(events, extant) << '\n';
+    }
+  }
+  return 0;
+}
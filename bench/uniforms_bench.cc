@@ -0,0 +1,87 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/migration.hh"
+#include "wagner/model.hh"
+#include "wagner/simd.hh"
+#include "wagner/uniforms.hh"
+#include "bench.hh"
+
+// The neutral migration phase as it was before the draws were taken in
+// blocks: one call to the distribution per trial.
+static auto migration_one_by_one(wagner::speciestree &tree,
+                                 wagner::network<wagner::point> const& landscape,
+                                 double mig_max, std::mt19937_64 &rng) -> size_t {
+  std::uniform_real_distribution<> unif;
+  std::vector<wagner::vertex> sources;
+  size_t new_pops = 0;
+  for (auto s0 : tree) {
+    sources.assign(s0->get_locations().begin(), s0->get_locations().end());
+    for (auto const& source : sources) {
+      for (auto location : landscape.neighbors(source)) {
+        if (s0->is_in(location)) continue;
+        if (unif(rng) < mig_max) {
+          s0->add_to(location);
+          ++new_pops;
+        }
+      }
+    }
+  }
+  return new_pops;
+}
+
+template<typename F>
+static auto time_pass(size_t communities, F&& pass) -> double {
+  auto rng = std::mt19937_64{42};
+  auto const landscape = bench::landscape(communities, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 10, 0.5f)};
+  bench::populate(tree, landscape, communities / 16, 64, rng);
+
+  auto const start = bench::clk::now();
+  pass(tree, landscape, rng);
+  return bench::ms_since(start);
+}
+
+auto main() -> int {
+  size_t const draws = 1 << 24;
+  std::cout << "simd: " << wagner::simd::isa() << "\n"
+            << "block  one by one (Mdraws/s)  buffer (Mdraws/s)  speedup\n";
+  for (size_t block : {8, 32, 128, 512, 2048}) {
+    double sink = 0.0;
+    auto rng = std::mt19937_64{42};
+    std::uniform_real_distribution<> unif;
+    auto const t0 = bench::clk::now();
+    for (size_t i = 0; i < draws; ++i) sink += unif(rng);
+    auto const one = bench::ms_since(t0);
+
+    auto const t1 = bench::clk::now();
+    {
+      wagner::uniform_buffer buffer(rng, block);
+      for (size_t i = 0; i < draws; ++i) sink += buffer();
+    }
+    auto const blocks = bench::ms_since(t1);
+    std::cout << block << "  " << draws / one / 1e3 << "  " << draws / blocks / 1e3 << "  "
+              << one / blocks << (sink < 0.0 ? " " : "") << '\n';
+  }
+
+  double const mig_max = 0.04;
+  std::cout << "\ncommunities  one by one (ms)  blocks (ms)  speedup (neutral migration)\n";
+  for (size_t communities : {4096, 16384, 65536}) {
+    auto const one = time_pass(communities,
+      [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+        migration_one_by_one(tree, l, mig_max, rng);
+      });
+    auto const blocks = time_pass(communities,
+      [&](wagner::speciestree &tree, wagner::network<wagner::point> const& l, std::mt19937_64 &rng) {
+        wagner::migration<wagner::model::neutral>(tree, l, 1, mig_max, 0.0, rng);
+      });
+    std::cout << communities << "  " << one << "  " << blocks << "  " << one / blocks << '\n';
+  }
+  return 0;
+}
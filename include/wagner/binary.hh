@@ -0,0 +1,274 @@
+#ifndef WAGNER_BINARY_HH_
+#define WAGNER_BINARY_HH_
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <utility>
+#include <vector>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/output.hh"
+
+/**
+  \file
+  \brief Binary output, an alternative to the XML files that is much cheaper
+         to parse.
+
+  Files are in the byte order of the machine that wrote them (checked by the
+  readers with the 'byte_order' field). Everything is stored at a multiple of 8
+  bytes from the beginning of the file, so the files can be mapped in memory
+  and their columns used in place.
+
+  w-<seed>.bin:
+    binary_run_header
+    double x[num_vertices], double y[num_vertices]: positions of the vertices.
+    num_trees records: uint64_t t, uint64_t length, the tree in Newick format
+      ('length' chars), zero padding to a multiple of 8 bytes.
+    uint64_t speciation_per_t[num_steps], extinctions_per_t[num_steps] and
+      species_per_t[num_steps], at 'series_offset'.
+
+  w-species-<seed>-t<t>.bin: binary_snapshot_header followed by the columns of
+  binary_snapshot_layout, each one padded to a multiple of 8 bytes.
+ */
+
+namespace wagner {
+
+/** Written as is, to check the byte order when reading. */
+constexpr uint32_t binary_byte_order = 0x01020304;
+
+/** Version of the binary format. */
+constexpr uint32_t binary_format_version = 1;
+
+/** Header of a w-<seed>.bin file. */
+struct binary_run_header {
+  char magic[8]; // "WAGNRUN" and a null character.
+  uint32_t byte_order;
+  uint32_t format_version;
+  uint64_t version;
+  uint64_t revision;
+  int32_t model;
+  int32_t sampler;
+  int32_t boundary;
+  int32_t schedule;
+  uint64_t seed;
+  uint64_t t_max;
+  uint64_t communities;
+  uint64_t attempts;
+  uint64_t num_traits;
+  double radius;
+  double aleph;
+  double speciation;
+  double migration;
+  double extinction;
+  float white_noise_std;
+  int32_t draws;
+  uint64_t num_vertices;
+  uint64_t num_trees;
+  uint64_t num_steps;
+  uint64_t series_offset;
+};
+
+/** Header of a w-species-<seed>-t<t>.bin file. */
+struct binary_snapshot_header {
+  char magic[8]; // "WAGNSPC" and a null character.
+  uint32_t byte_order;
+  uint32_t format_version;
+  uint64_t t;
+  uint64_t num_species;
+  uint64_t num_traits;
+  uint64_t num_locations; // Summed over all species.
+};
+
+/** Offsets, in bytes, of the columns of a snapshot file. */
+struct binary_snapshot_layout {
+  size_t ids; // uint64_t[num_species]
+  size_t centroid_x; // double[num_species]
+  size_t centroid_y; // double[num_species]
+  size_t first_location; // uint64_t[num_species + 1], index in the next two columns.
+  size_t vertices; // uint32_t[num_locations]
+  size_t groups; // int32_t[num_locations]
+  size_t traits; // float[num_species * num_traits], one row per species.
+  size_t size; // Size of the file.
+
+  /** Layout of the file described by the header. */
+  explicit binary_snapshot_layout(binary_snapshot_header const& h) noexcept;
+};
+
+/** Writes a w-<seed>.bin file as the simulation goes. */
+class binary_run_writer {
+  std::ofstream m_out;
+  binary_run_header m_header;
+
+ public:
+  /** Basic constructor (no file). */
+  binary_run_writer() noexcept;
+
+  /** Create the file, write the parameters and the positions of the vertices. */
+  auto open(const char *path, run_info const& info,
+            std::vector<point> const& positions) noexcept -> void;
+
+  /** Open a file written up to 'size' bytes, with 'num_trees' trees, and drop
+    * what comes after (see checkpoint.hh). Return false if it cannot be cut
+    * and opened. */
+  auto reopen(const char *path, run_info const& info, size_t num_vertices,
+              size_t size, size_t num_trees) noexcept -> bool;
+
+  /** Flush the file, return its size. */
+  auto size() noexcept -> size_t;
+
+  /** True if every write so far went through. */
+  auto good() const noexcept -> bool {
+    return m_out.good();
+  }
+
+  /** Number of trees written. */
+  auto num_trees() const noexcept -> size_t {
+    return m_header.num_trees;
+  }
+
+  /** Append a tree in Newick format. */
+  template<typename Tree>
+  auto tree(size_t t, Tree const& tree) noexcept -> void {
+    uint64_t const head[2] = {t, 0};
+    auto const start = m_out.tellp();
+    m_out.write(reinterpret_cast<const char*>(head), sizeof(head));
+    m_out << tree;
+    m_end_tree(start);
+  }
+
+  /** Write the time series ('n' time steps), update the header and close. */
+  auto close(const size_t *speciation_per_t, const size_t *extinctions_per_t,
+             const size_t *species_per_t, size_t n) noexcept -> void;
+
+ private:
+  auto m_fill_header(run_info const& info, size_t num_vertices) noexcept -> void;
+  auto m_end_tree(std::streampos start) noexcept -> void;
+};
+
+/** A file mapped in memory, read-only. */
+class mapped_file {
+  const char *m_data;
+  size_t m_size;
+
+ public:
+  /** Basic constructor (no file). */
+  mapped_file() noexcept;
+
+  mapped_file(const mapped_file&) = delete;
+  auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+  /** Unmap the file. */
+  ~mapped_file() noexcept;
+
+  /** Map a file, return false if it cannot be read. */
+  auto open(const char *path) noexcept -> bool;
+
+  auto data() const noexcept -> const char* {
+    return m_data;
+  }
+
+  auto size() const noexcept -> size_t {
+    return m_size;
+  }
+};
+
+/** Reads a w-<seed>.bin file in place. */
+class binary_run_reader {
+  mapped_file m_file;
+  const binary_run_header *m_header;
+  std::vector<size_t> m_trees; // Offset of each tree record.
+
+ public:
+  /** Basic constructor (no file). */
+  binary_run_reader() noexcept;
+
+  /** Map and check a file, return false if it is not a valid run file. */
+  auto open(const char *path) noexcept -> bool;
+
+  auto header() const noexcept -> binary_run_header const& {
+    return *m_header;
+  }
+
+  /** Parameters of the run. */
+  auto info() const noexcept -> run_info;
+
+  /** Positions of the vertices of the landscape. */
+  auto positions() const noexcept -> std::vector<point>;
+
+  auto num_trees() const noexcept -> size_t {
+    return m_trees.size();
+  }
+
+  /** Time of the ith tree. */
+  auto tree_time(size_t i) const noexcept -> size_t;
+
+  /** The ith tree in Newick format (not null-terminated) and its length. */
+  auto tree(size_t i) const noexcept -> std::pair<const char*, size_t>;
+
+  auto num_steps() const noexcept -> size_t {
+    return m_header->num_steps;
+  }
+
+  auto speciation_per_t() const noexcept -> const uint64_t*;
+  auto extinctions_per_t() const noexcept -> const uint64_t*;
+  auto species_per_t() const noexcept -> const uint64_t*;
+
+  /** Write the run in the format of the w-<seed>.xml file. */
+  auto write_xml(std::ostream &os) const noexcept -> void;
+};
+
+/** Reads a w-species-<seed>-t<t>.bin file in place. */
+class binary_snapshot_reader {
+  mapped_file m_file;
+  const binary_snapshot_header *m_header;
+
+  template<typename T>
+  auto m_column(size_t offset) const noexcept -> const T* {
+    return reinterpret_cast<const T*>(m_file.data() + offset);
+  }
+
+ public:
+  /** Basic constructor (no file). */
+  binary_snapshot_reader() noexcept;
+
+  /** Map and check a file, return false if it is not a valid snapshot file. */
+  auto open(const char *path) noexcept -> bool;
+
+  auto header() const noexcept -> binary_snapshot_header const& {
+    return *m_header;
+  }
+
+  auto t() const noexcept -> size_t {
+    return m_header->t;
+  }
+
+  auto num_species() const noexcept -> size_t {
+    return m_header->num_species;
+  }
+
+  auto num_traits() const noexcept -> size_t {
+    return m_header->num_traits;
+  }
+
+  auto num_locations() const noexcept -> size_t {
+    return m_header->num_locations;
+  }
+
+  auto ids() const noexcept -> const uint64_t*;
+  auto centroid_x() const noexcept -> const double*;
+  auto centroid_y() const noexcept -> const double*;
+  auto first_location() const noexcept -> const uint64_t*;
+  auto vertices() const noexcept -> const uint32_t*;
+  auto groups() const noexcept -> const int32_t*;
+  auto traits() const noexcept -> const float*;
+
+  /** Write the snapshot in the format of the w-species-<seed>-t<t>.xml file,
+    * with the positions of the vertices of the run. */
+  auto write_xml(std::ostream &os, std::vector<point> const& positions) const noexcept -> void;
+};
+
+}
+
+#endif
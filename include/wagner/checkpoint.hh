@@ -0,0 +1,179 @@
+#ifndef WAGNER_CHECKPOINT_HH_
+#define WAGNER_CHECKPOINT_HH_
+
+#include <cstdint>
+#include <string>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/output.hh"
+#include "wagner/binary.hh"
+#include "wagner/speciestree.hh"
+
+/**
+  \file
+  \brief Checkpoints: the state of a run between two time steps, to resume it
+         after the process is killed.
+
+  A checkpoint holds the parameters of the run, the landscape, the tree (its
+  nodes with their end dates, the locations and traits of the species), the
+  time series, the state of the random number engine and distributions, and the
+  size of the info files when it was taken. The simulation then goes on exactly
+  as if it had not stopped.
+
+  The file is built in memory and written at once, next to the previous one,
+  which it replaces only once complete. Like the binary output (see binary.hh),
+  it is in the byte order of the machine, with every column at a multiple of 8
+  bytes, and it is read in place.
+
+  w-<seed>.ckpt: checkpoint_header followed by the columns of
+  checkpoint_layout, each one padded to a multiple of 8 bytes.
+ */
+
+namespace wagner {
+
+/** Version of the checkpoint format. */
+constexpr uint32_t checkpoint_format_version = 1;
+
+/** Header of a w-<seed>.ckpt file. */
+struct checkpoint_header {
+  char magic[8]; // "WAGNCKP" and a null character.
+  uint32_t byte_order;
+  uint32_t format_version;
+  // Parameters of the run (see run_info):
+  uint64_t version;
+  uint64_t revision;
+  int32_t model;
+  int32_t sampler;
+  int32_t boundary;
+  int32_t schedule;
+  uint64_t seed;
+  uint64_t t_max;
+  uint64_t communities;
+  uint64_t attempts;
+  uint64_t num_traits;
+  double radius;
+  double aleph;
+  double speciation;
+  double migration;
+  double extinction;
+  float white_noise_std;
+  int32_t draws;
+  // Where the run stands (see checkpoint_progress):
+  int32_t format;
+  uint32_t migration_threads;
+  uint64_t interval;
+  uint64_t t;
+  uint64_t populations;
+  uint64_t info_size;
+  uint64_t bin_size;
+  uint64_t bin_trees;
+  // The tree (see tree_columns):
+  uint64_t start_date;
+  uint64_t id_count;
+  uint64_t num_slots;
+  uint64_t num_free_slots;
+  uint64_t num_nodes;
+  uint64_t num_species;
+  uint64_t num_locations;
+  // The landscape:
+  uint64_t num_vertices;
+  uint64_t num_edges;
+  uint64_t engines_size; // Characters of checkpoint_progress::engines.
+};
+
+/** Offsets, in bytes, of the columns of a checkpoint file. */
+struct checkpoint_layout {
+  size_t x; // double[num_vertices]
+  size_t y; // double[num_vertices]
+  size_t offsets; // uint32_t[num_vertices + 1], see network::offsets.
+  size_t adjacency; // uint32_t[num_edges]
+  size_t free_slots; // uint64_t[num_free_slots]
+  size_t end_dates; // uint64_t[num_nodes], in preorder.
+  size_t leaves; // uint8_t[num_nodes]
+  size_t ids; // uint64_t[num_species], in the order of the leaves.
+  size_t slots; // uint64_t[num_species]
+  size_t first_location; // uint64_t[num_species + 1], index in the next column.
+  size_t locations; // uint32_t[num_locations]
+  size_t traits; // float[num_species * num_traits], one row per species.
+  size_t speciation_per_t; // uint64_t[t]
+  size_t extinctions_per_t; // uint64_t[t]
+  size_t species_per_t; // uint64_t[t]
+  size_t engines; // char[engines_size]
+  size_t size; // Size of the file.
+
+  /** Layout of the file described by the header. */
+  explicit checkpoint_layout(checkpoint_header const& h) noexcept;
+};
+
+/** Where a run stands at the end of a time step, besides its landscape, its
+  * tree and its time series. */
+struct checkpoint_progress {
+  output_format format;
+  size_t migration_threads;
+  size_t interval; // Time steps between two checkpoints.
+  size_t t; // Time steps done.
+  size_t populations;
+  size_t info_size; // Bytes written to w-<seed>.xml.
+  size_t bin_size; // Bytes written to w-<seed>.bin.
+  size_t bin_trees; // Trees written to w-<seed>.bin.
+  std::string engines; // The random number engine and distributions, as text.
+};
+
+/** Write a checkpoint of a run after 'progress.t' time steps. The file is
+  * replaced only once the new one is complete. Return false if it cannot be
+  * written. */
+auto write_checkpoint(const char *path, run_info const& info,
+                      checkpoint_progress const& progress,
+                      network<point> const& landscape, speciestree const& tree,
+                      const size_t *speciation_per_t, const size_t *extinctions_per_t,
+                      const size_t *species_per_t) noexcept -> bool;
+
+/** Reads a w-<seed>.ckpt file in place. */
+class checkpoint_reader {
+  mapped_file m_file;
+  const checkpoint_header *m_header;
+  checkpoint_layout m_layout;
+
+  template<typename T>
+  auto m_column(size_t offset) const noexcept -> const T* {
+    return reinterpret_cast<const T*>(m_file.data() + offset);
+  }
+
+  /** Whether the parameters are in range, the columns of the landscape form a
+    * network and those of the tree one binary tree (see open). */
+  auto m_valid() const noexcept -> bool;
+
+ public:
+  /** Basic constructor (no file). */
+  checkpoint_reader() noexcept;
+
+  /** Map and check a file, return false if it is not a valid checkpoint:
+    * besides its header, the contents are checked, so that a damaged file of
+    * the right size is rejected instead of being read out of bounds. */
+  auto open(const char *path) noexcept -> bool;
+
+  auto header() const noexcept -> checkpoint_header const& {
+    return *m_header;
+  }
+
+  /** Parameters of the run. */
+  auto info() const noexcept -> run_info;
+
+  /** Where the run stands. */
+  auto progress() const noexcept -> checkpoint_progress;
+
+  /** The landscape of the run. */
+  auto landscape() const noexcept -> network<point>;
+
+  /** The tree, pointing into the file (see speciestree::speciestree). */
+  auto tree() const noexcept -> tree_columns;
+
+  auto speciation_per_t() const noexcept -> const uint64_t*;
+  auto extinctions_per_t() const noexcept -> const uint64_t*;
+  auto species_per_t() const noexcept -> const uint64_t*;
+};
+
+}
+
+#endif
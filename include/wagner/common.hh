@@ -2,6 +2,7 @@
 #define WAGNER_COMMON_H_
 
 #include <cmath>
+#include <functional>
 
 #ifndef WAGNER_NOBOOST
   #include <boost/container/flat_set.hpp>
@@ -14,14 +15,14 @@
 namespace wagner {
 
 #ifndef WAGNER_NOBOOST
-  template<typename Key>
-  using set = boost::container::flat_set<Key>;
+  template<typename Key, typename Compare = std::less<Key>>
+  using set = boost::container::flat_set<Key, Compare>;
 
   template<typename Key, typename Value>
   using map = boost::container::flat_map<Key, Value>;
 #else
-  template<typename Key>
-  using set = std::set<Key>;
+  template<typename Key, typename Compare = std::less<Key>>
+  using set = std::set<Key, Compare>;
 
   template<typename Key, typename Value>
   using map = std::map<Key, Value>;
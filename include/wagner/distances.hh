@@ -0,0 +1,43 @@
+#ifndef WAGNER_DISTANCES_HH_
+#define WAGNER_DISTANCES_HH_
+
+#include <vector>
+#include "wagner/common.hh"
+
+namespace wagner {
+
+/** A symmetric matrix of pairwise distances between species, indexed by the
+  * slots the speciestree gives to extant species. */
+class distance_matrix {
+  std::vector<float> m_d; // Row-major, m_cap * m_cap.
+  size_t m_cap; // Number of rows (and columns).
+
+ public:
+  /** Basic constructor (empty matrix). */
+  distance_matrix() noexcept;
+
+  /** Number of rows/columns available. */
+  auto capacity() const noexcept -> size_t;
+
+  /** Make sure 'slot' is a valid index, preserving the current distances. */
+  auto reserve(size_t slot) noexcept -> void;
+
+  /** Copy the distances of slot 'from' to slot 'to', and set the distance
+    * between both to zero (used when a species inherits its parent traits). */
+  auto copy(size_t from, size_t to) noexcept -> void;
+
+  /** Set the distance between slots 'a' and 'b'. */
+  auto set(size_t a, size_t b, float d) noexcept -> void {
+    m_d[a * m_cap + b] = d;
+    m_d[b * m_cap + a] = d;
+  }
+
+  /** Distance between slots 'a' and 'b'. */
+  auto operator()(size_t a, size_t b) const noexcept -> float {
+    return m_d[a * m_cap + b];
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef WAGNER_FENWICK_HH_
+#define WAGNER_FENWICK_HH_
+
+#include <vector>
+#include <utility>
+
+namespace wagner {
+
+/** Fenwick (binary indexed) tree over non-negative weights: updates, prefix
+  * sums and weighted draws in O(log n). */
+template<typename T>
+class fenwick {
+  std::vector<T> m_tree; // m_tree[i - 1] sums the weights (i - lowbit(i), i].
+  T m_total;
+
+ public:
+  /** Basic constructor. */
+  fenwick() noexcept : m_total(0) {
+    //
+  }
+
+  /** Build the tree from a vector of weights, in O(n). */
+  explicit fenwick(std::vector<T> weights) noexcept
+    : m_tree(std::move(weights)), m_total(0) {
+    auto const n = m_tree.size();
+    for (auto w : m_tree) {
+      m_total += w;
+    }
+    for (size_t i = 1; i <= n; ++i) {
+      auto const parent = i + (i & (~i + 1));
+      if (parent <= n) {
+        m_tree[parent - 1] += m_tree[i - 1];
+      }
+    }
+  }
+
+  /** Number of weights. */
+  auto size() const noexcept -> size_t {
+    return m_tree.size();
+  }
+
+  /** Sum of all weights. */
+  auto total() const noexcept -> T {
+    return m_total;
+  }
+
+  /** Add 'delta' to the ith weight. */
+  auto add(size_t i, T delta) noexcept -> void {
+    m_total += delta;
+    for (++i; i <= m_tree.size(); i += i & (~i + 1)) {
+      m_tree[i - 1] += delta;
+    }
+  }
+
+  /** Sum of the first 'i' weights. */
+  auto prefix(size_t i) const noexcept -> T {
+    T sum = 0;
+    for (; i > 0; i -= i & (~i + 1)) {
+      sum += m_tree[i - 1];
+    }
+    return sum;
+  }
+
+  /** Find the weight covering 'x' (0 <= x < total()) when the weights are laid
+    * end to end. Returns its index and the offset of 'x' inside it. */
+  auto find(T x) const noexcept -> std::pair<size_t, T> {
+    size_t i = 0;
+    size_t step = 1;
+    while (step * 2 <= m_tree.size()) {
+      step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+      if (i + step <= m_tree.size() && m_tree[i + step - 1] <= x) {
+        i += step;
+        x -= m_tree[i - 1];
+      }
+    }
+    return std::make_pair(i, x);
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef WAGNER_MIGRATION_HH_
+#define WAGNER_MIGRATION_HH_
+
+#include <random>
+#include <vector>
+#include <cstdint>
+#include "wagner/common.hh"
+#include "wagner/model.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/thread_pool.hh"
+
+namespace wagner {
+
+/**
+  \brief Migration phase: each population tries to colonize the neighboring
+         communities where its species is absent.
+
+  The phase is specialized for each model at compile time (explicitly
+  instantiated for the four models in migration.cc). Populations founded during
+  the phase do not migrate until the next time step.
+  The competition term only visits the species living in the target community
+  (see speciestree::residents). Trait-based models read the distances cached
+  by speciestree::update_distances. The uniform draws of the trials are taken
+  in blocks (see uniform_buffer), with the same results as one by one.
+
+  \tparam m                 The model to use.
+  \param tree               The extant species.
+  \param landscape          The spatial network.
+  \param t                  Current time step.
+  \param mig_max            Max migration rate.
+  \param aleph
+  \param rng                Random number generator.
+  \param draws              One draw per trial, or one per target community
+                            with the probability that one of its trials
+                            succeeds (same distribution, fewer draws).
+  \return                   The number of new populations.
+ */
+template<model m>
+auto migration(speciestree &tree, network<point> const& landscape,
+               size_t t, double mig_max, double aleph,
+               std::mt19937_64 &rng,
+               migration_draws draws = migration_draws::per_trial) noexcept -> size_t;
+
+/**
+  \brief Migration phase on a pool of threads, with the synchronous schedule.
+
+  Every species sees the populations of the start of the phase: the species
+  draw their new populations in parallel, then the populations are added in
+  the order of the tree. Each species draws from its own philox stream, named
+  by the time step and its id, so the results do not depend on the number of
+  threads. The migration rates are the ones of migration<m>.
+ */
+class synchronous_migration {
+  thread_pool m_workers;
+  uint64_t m_seed;
+  std::vector<species*> m_species;
+  std::vector<std::vector<vertex>> m_founded; // New populations of each species.
+
+ public:
+  /** Start 'threads' workers (at least one) for the run of seed 'seed'. */
+  synchronous_migration(size_t threads, uint64_t seed) noexcept;
+
+  /** Run the phase (see migration<m>), return the number of new populations. */
+  template<model m>
+  auto run(speciestree &tree, network<point> const& landscape,
+           size_t t, double mig_max, double aleph,
+           migration_draws draws = migration_draws::per_trial) noexcept -> size_t;
+};
+
+}
+
+#endif
@@ -32,6 +32,42 @@ inline auto operator<<(std::ostream& os, model const& m) -> std::ostream& {
   return os;
 }
 
+// Order of the migrations within a time step:
+enum class schedule {
+  sequential = 0, // One species after the other, each one seeing the populations founded before it.
+  synchronous = 1 // All the species see the populations of the start of the phase.
+};
+
+inline auto operator<<(std::ostream& os, schedule const& s) -> std::ostream& {
+  switch (s) {
+    case schedule::sequential:
+      os << "sequential";
+      break;
+    case schedule::synchronous:
+      os << "synchronous";
+      break;
+  }
+  return os;
+}
+
+// Random draws of the migration phase:
+enum class migration_draws {
+  per_trial = 0, // One per population and empty neighbor.
+  per_target = 1 // One per empty neighbor of k populations: 1 - (1 - m)^k.
+};
+
+inline auto operator<<(std::ostream& os, migration_draws const& d) -> std::ostream& {
+  switch (d) {
+    case migration_draws::per_trial:
+      os << "per trial";
+      break;
+    case migration_draws::per_target:
+      os << "per target";
+      break;
+  }
+  return os;
+}
+
 }
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef WAGNER_MRCA_HH_
+#define WAGNER_MRCA_HH_
+
+#include <vector>
+#include <cstdint>
+#include "wagner/common.hh"
+#include "wagner/tbranch.hh"
+
+namespace wagner {
+
+/** Constant-time most-recent-common-ancestor queries on a tbranch tree: an
+  * Euler tour of the tree with a sparse table of range minima over the depths.
+  * The index must be rebuilt when the tree changes. */
+class mrca_index {
+  std::vector<const tbranch*> m_tour; // Nodes in Euler-tour order.
+  std::vector<uint32_t> m_depth; // Depth of the nodes in m_tour.
+  std::vector<std::vector<uint32_t>> m_sparse; // m_sparse[k][i]: shallowest position in [i, i + 2^k).
+
+ public:
+  /** Basic constructor (empty index). */
+  mrca_index() noexcept;
+
+  /** Index the tree rooted at 'root' (iterative, so deep trees are fine). */
+  auto build(tbranch *root) noexcept -> void;
+
+  /** The most recent common ancestor of two nodes of the indexed tree. */
+  auto operator()(const tbranch *t0, const tbranch *t1) const noexcept -> const tbranch*;
+};
+
+}
+
+#endif
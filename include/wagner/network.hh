@@ -3,202 +3,290 @@
 
 #include <iostream>
 #include <cstdio>
+#include <cstdint>
 #include <string>
 #include <random>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
 #include "wagner/common.hh"
 
 namespace wagner {
 
+/** Dense index of a vertex in a network (0 to order() - 1). */
+using vertex = uint32_t;
+
+/** Immutable network stored in compressed-sparse-row form: the neighbors of
+  * vertex v are adjacency[offsets[v]] to adjacency[offsets[v + 1] - 1], sorted.
+  * The value attached to each vertex (e.g.: its coordinates) is kept in a side
+  * table. */
 template<typename T>
 class network {
-  map<T, set<T>> m_net;
-  auto m_test_connectivity(map<T, bool> &vs, const T &t) noexcept -> void;
+  std::vector<T> m_vertices; // Value of each vertex.
+  std::vector<uint32_t> m_offsets; // order() + 1 offsets in m_adjacency.
+  std::vector<vertex> m_adjacency; // Concatenated neighbor lists.
 
  public:
- 
-  using const_iterator = typename map<T, set<T>>::const_iterator; 
- 
+  /** A contiguous range of neighbors. */
+  class neighborhood {
+    const vertex *m_begin;
+    const vertex *m_end;
+
+   public:
+    neighborhood(const vertex *b, const vertex *e) noexcept : m_begin(b), m_end(e) {
+      //
+    }
+
+    auto begin() const noexcept -> const vertex* {
+      return m_begin;
+    }
+
+    auto end() const noexcept -> const vertex* {
+      return m_end;
+    }
+
+    auto size() const noexcept -> size_t {
+      return m_end - m_begin;
+    }
+
+    auto empty() const noexcept -> bool {
+      return m_begin == m_end;
+    }
+  };
+
   /** Basic constructor. */
-  network() noexcept {
+  network() noexcept : m_offsets(1, 0) {
+    //
+  }
+
+  /** Build a network from its vertices and a list of directed edges. */
+  network(std::vector<T> vertices,
+          std::vector<std::pair<vertex, vertex>> edges) noexcept;
+
+  /** Build a network from its vertices and its adjacency in compressed-sparse-row
+    * form (see offsets and adjacency), with the neighbors of each vertex sorted. */
+  network(std::vector<T> vertices, std::vector<uint32_t> offsets,
+          std::vector<vertex> adjacency) noexcept
+    : m_vertices(std::move(vertices)), m_offsets(std::move(offsets)),
+      m_adjacency(std::move(adjacency)) {
     //
   }
 
   /** Number of edges in the entire network. */
   auto size() const noexcept -> size_t {
-    size_t sum = 0;
-    for (auto i : m_net) sum += i.second.size();
-    return sum;
+    return m_adjacency.size();
   }
 
-  /** Number of edges in node t. */
-  auto size(const T &t) const noexcept -> size_t {
-    return m_net[t].size();
+  /** Number of edges in vertex v. */
+  auto size(vertex v) const noexcept -> size_t {
+    return m_offsets[v + 1] - m_offsets[v];
   }
 
   /** Number or vertices. */
   auto order() const noexcept -> size_t {
-    return m_net.size();
+    return m_vertices.size();
   }
 
-  /** Destroy all vertices and create a random geometric graph. */
+  /** Destroy all vertices and create a random geometric graph in the unit
+    * square, in about O(n + E) with a uniform grid. Vertices are numbered in
+    * increasing order of their values. */
   auto rgg(size_t order, double radius, std::mt19937_64 &rng) noexcept -> void;
 
-  // static auto make_rgg(size_t order, double radius, std::mt19937_64& rng) -> network<T>;
-  // static auto make_rg(size_t order, double alpha, std::mt19937_64& rng) -> network<T>;
-  // static auto make_grid(size_t rows, size_t columns) -> network<T>;
-
-  /** Returns true if the network is strongly connected. */
-  auto connected() noexcept -> bool;
+  /** Returns true if the network is strongly connected (linear time). */
+  auto connected() const noexcept -> bool;
 
   /** Returns one vertex of the graph at random. */
-  auto random_vertex(std::mt19937_64 &rng) const noexcept -> const_iterator;
+  auto random_vertex(std::mt19937_64 &rng) const noexcept -> vertex;
 
   /** Returns true if the vertex is present. */
-  auto has_vertex(const T &t) const noexcept -> bool;
+  auto has_vertex(vertex v) const noexcept -> bool {
+    return v < m_vertices.size();
+  }
 
   /** Returns true if an edge is present between v0 and v1. */
-  auto has_edge(const T &t0, const T &t1) const noexcept -> bool;
+  auto has_edge(vertex v0, vertex v1) const noexcept -> bool;
 
-  /** Adds a vertex. */
-  auto add_vertex(const T &t) noexcept -> bool;
-
-  /** Adds an edge between vertices v0 and v1. */
-  auto add_edge(const T &t0, const T &t1) noexcept -> size_t;
-
-  /** Adds an edge between vertives v0 and v1 and betwen v1 and v0. Return the
-   * number of edges added. */
-  auto add_edges(const T &t0, const T &t1) noexcept -> size_t;
-
-  /** Returns the set of neighbors for vertex 'v'. */
-  auto neighbors(const T &t) const noexcept -> set<T> const&;
+  /** Value attached to vertex 'v'. */
+  auto value(vertex v) const noexcept -> T const& {
+    return m_vertices[v];
+  }
 
-  /** Returns the set of neighbors for vertex 'v'. */
-  auto operator[](const T &t) const noexcept -> set<T> const&;
+  /** Values of all vertices, indexed by vertex. */
+  auto values() const noexcept -> std::vector<T> const& {
+    return m_vertices;
+  }
 
-  // Iterate the network:
-  auto begin() noexcept -> typename map<T, set<T>>::iterator {
-    return m_net.begin();
+  /** The order() + 1 offsets of the neighbor lists in adjacency(). */
+  auto offsets() const noexcept -> std::vector<uint32_t> const& {
+    return m_offsets;
   }
 
-  auto end() noexcept -> typename map<T, set<T>>::iterator {
-    return m_net.end();
+  /** The neighbor lists of all vertices, one after the other. */
+  auto adjacency() const noexcept -> std::vector<vertex> const& {
+    return m_adjacency;
   }
 
-  auto begin() const noexcept -> typename map<T, set<T>>::const_iterator {
-    return m_net.begin();
+  /** Returns the neighbors of vertex 'v'. */
+  auto neighbors(vertex v) const noexcept -> neighborhood {
+    return neighborhood(m_adjacency.data() + m_offsets[v],
+                        m_adjacency.data() + m_offsets[v + 1]);
   }
 
-  auto end() const noexcept -> typename map<T, set<T>>::const_iterator {
-    return m_net.end();
+  /** Returns the neighbors of vertex 'v'. */
+  auto operator[](vertex v) const noexcept -> neighborhood {
+    return neighbors(v);
   }
 };
 
 template<typename T>
-auto network<T>::m_test_connectivity(map<T, bool> &vs, const T &v) noexcept -> void {
-  set<T> ns = neighbors(v);
-  for (auto i : ns) {
-    if (vs[i] == false) {
-      vs[i] = true;
-      m_test_connectivity(vs, i);
-    }
+network<T>::network(std::vector<T> vertices,
+                    std::vector<std::pair<vertex, vertex>> edges) noexcept
+  : m_vertices(std::move(vertices)), m_offsets(m_vertices.size() + 1, 0) {
+  for (auto const& e : edges) {
+    ++m_offsets[e.first + 1];
+  }
+  for (size_t v = 0; v < m_vertices.size(); ++v) {
+    m_offsets[v + 1] += m_offsets[v];
+  }
+  m_adjacency.resize(edges.size());
+  auto next = std::vector<uint32_t>(m_offsets.begin(), m_offsets.end() - 1);
+  for (auto const& e : edges) {
+    m_adjacency[next[e.first]++] = e.second;
+  }
+  for (size_t v = 0; v < m_vertices.size(); ++v) {
+    auto const b = m_adjacency.begin() + m_offsets[v];
+    auto const e = m_adjacency.begin() + m_offsets[v + 1];
+    std::sort(b, e);
   }
 }
 
 template<typename T>
-auto network<T>::connected() noexcept -> bool {
-  for (auto i : m_net) {
-    map<T, bool> is;
-    for (auto j : m_net) {
-      is[j.first] = (j.first == i.first);
-    }
-    m_test_connectivity(is, i.first);
+auto network<T>::connected() const noexcept -> bool {
+  auto const n = m_vertices.size();
+  if (n < 2) {
+    return true;
+  }
 
-    for (auto j : is) {
-      if (j.second == false) {
-        return false;
+  // Breadth-first search from vertex 0, once along the edges and once against
+  // them (on the transposed adjacency): the network is strongly connected iff
+  // every vertex is reached both times.
+  auto seen = std::vector<bool>(n, false);
+  auto queue = std::vector<vertex>(n);
+  auto reach = [&](std::vector<uint32_t> const& offsets,
+                   std::vector<vertex> const& adjacency) -> bool {
+    std::fill(seen.begin(), seen.end(), false);
+    size_t head = 0, tail = 0;
+    queue[tail++] = 0;
+    seen[0] = true;
+    while (head < tail) {
+      auto const v = queue[head++];
+      for (auto i = offsets[v]; i < offsets[v + 1]; ++i) {
+        auto const u = adjacency[i];
+        if (!seen[u]) {
+          seen[u] = true;
+          queue[tail++] = u;
+        }
       }
     }
+    return tail == n;
+  };
+
+  if (!reach(m_offsets, m_adjacency)) {
+    return false;
+  }
+
+  auto offsets = std::vector<uint32_t>(n + 1, 0);
+  for (auto u : m_adjacency) {
+    ++offsets[u + 1];
   }
-  return true;
+  for (size_t v = 0; v < n; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  auto adjacency = std::vector<vertex>(m_adjacency.size());
+  auto next = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+  for (vertex v = 0; v < n; ++v) {
+    for (auto u : neighbors(v)) {
+      adjacency[next[u]++] = v;
+    }
+  }
+  return reach(offsets, adjacency);
 }
 
 template<typename T>
-auto network<T>::random_vertex(std::mt19937_64 &rng) const noexcept -> const_iterator {
-  if (m_net.size() < 2) {
-    return m_net.begin();
-  }
-  auto unif = std::uniform_int_distribution<size_t>(0, m_net.size() - 1);
-  auto it = m_net.begin();
-  std::advance(it, unif(rng));
-  return it;
+auto network<T>::random_vertex(std::mt19937_64 &rng) const noexcept -> vertex {
+  if (m_vertices.size() < 2) {
+    return 0;
+  }
+  auto unif = std::uniform_int_distribution<size_t>(0, m_vertices.size() - 1);
+  return unif(rng);
 }
 
 template<typename T>
 auto network<T>::rgg(size_t order, double radius, std::mt19937_64 &rng) noexcept -> void {
   std::uniform_real_distribution<> unif;
-  m_net.clear();
-  for (int i = 0; i < order; ++i) {
+  auto vs = std::vector<T>{};
+  vs.reserve(order);
+  for (size_t i = 0; i < order; ++i) {
     T p(unif(rng), unif(rng));
-    auto emps = set<T>{};
-    m_net.insert(std::pair<T, set<T>>(p, emps));
+    vs.push_back(p);
   }
-  for (auto i : m_net) {
-    for (auto j : m_net) {
-      if (euclidean_distance(i.first, j.first) < radius) {
-        add_edges(i.first, j.first);
-      }
-    }
+  std::sort(vs.begin(), vs.end());
+  vs.erase(std::unique(vs.begin(), vs.end()), vs.end());
+  auto const n = vs.size();
+
+  // Bucket the vertices in a k * k grid of cells at least 'radius' wide, so
+  // only the 9 cells around a vertex can hold its neighbors. The grid is
+  // capped at about 4n cells for tiny radii, in double so that radii of zero
+  // or less (no edges) do not overflow the conversion.
+  auto const max_k = max2((size_t)1, (size_t)(2.0 * std::sqrt((double)n)));
+  auto const k = radius >= 1.0 ? (size_t)1
+               : !(radius > 0.0) || 1.0 / radius >= (double)max_k ? max_k
+               : max2((size_t)1, (size_t)(1.0 / radius));
+  auto cell = [k](double c) -> size_t {
+    return min2(k - 1, (size_t)(c * k));
+  };
+  auto cells = std::vector<uint32_t>(k * k + 1, 0); // Counting sort by cell.
+  auto in_cell = std::vector<vertex>(n);
+  for (auto const& p : vs) {
+    ++cells[cell(p.y) * k + cell(p.x) + 1];
   }
-}
-
-template<typename T>
-auto network<T>::has_vertex(const T &t) const noexcept -> bool {
-  return m_net.find(t) != m_net.end();
-}
-
-template<typename T>
-auto network<T>::has_edge(const T &t0, const T &t1) const noexcept -> bool {
-  return has_vertex(t0) && has_vertex(t1) && (m_net.at(t0).find(t1) != m_net.at(t0).end());
-}
-
-template<typename T>
-auto network<T>::add_vertex(const T &t) noexcept -> bool {
-  if (has_vertex(t)) {
-    return false;
-  } else {
-    auto emps = set<T>{};
-    m_net.insert(std::pair<T, set<T>>(t, emps));
-    return true;
+  for (size_t c = 0; c < k * k; ++c) {
+    cells[c + 1] += cells[c];
   }
-}
-
-template<typename T>
-auto network<T>::add_edge(const T &t0, const T &t1) noexcept -> size_t {
-  if (has_vertex(t0)) {
-    if (has_edge(t0, t1)) {
-      return 0;
-    } else {
-      m_net[t0].insert(t1);
-      return 1;
+  {
+    auto next = std::vector<uint32_t>(cells.begin(), cells.end() - 1);
+    for (vertex i = 0; i < n; ++i) {
+      in_cell[next[cell(vs[i].y) * k + cell(vs[i].x)]++] = i;
     }
-  } else {
-    return 0;
   }
-}
-
-template<typename T>
-auto network<T>::add_edges(const T &t0, const T &t1) noexcept -> size_t {
-  return add_edge(t0, t1) + add_edge(t1, t0);
-}
 
-template<typename T>
-auto network<T>::neighbors(const T &t) const noexcept -> set<T> const& {
-  return m_net.at(t);
+  auto edges = std::vector<std::pair<vertex, vertex>>{};
+  for (vertex i = 0; i < n; ++i) {
+    auto const cx = cell(vs[i].x), cy = cell(vs[i].y);
+    for (auto y = cy == 0 ? 0 : cy - 1; y <= min2(k - 1, cy + 1); ++y) {
+      for (auto x = cx == 0 ? 0 : cx - 1; x <= min2(k - 1, cx + 1); ++x) {
+        auto const c = y * k + x;
+        for (auto l = cells[c]; l < cells[c + 1]; ++l) {
+          auto const j = in_cell[l];
+          if (j > i && euclidean_distance(vs[i], vs[j]) < radius) {
+            edges.emplace_back(i, j);
+            edges.emplace_back(j, i);
+          }
+        }
+      }
+    }
+  }
+  *this = network<T>(std::move(vs), std::move(edges));
 }
 
 template<typename T>
-auto network<T>::operator[](const T &t) const noexcept -> set<T> const& {
-  return m_net.at(t);
+auto network<T>::has_edge(vertex v0, vertex v1) const noexcept -> bool {
+  if (!has_vertex(v0) || !has_vertex(v1)) {
+    return false;
+  }
+  auto const ns = neighbors(v0);
+  return std::binary_search(ns.begin(), ns.end(), v1);
 }
 
 template<typename T>
@@ -208,14 +296,16 @@ auto operator<<(std::ostream &os, const network<T> &net) noexcept -> std::ostrea
   os << " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"";
   os << " xsi:schemaLocation=\"http://graphml.graphdrawing.org/xmlns "
         "http://graphml.graphdrawing.org/xmlns/1.0/graphml.xsd\">\n";
+  os << "  <key id=\"position\" for=\"node\" attr.name=\"position\" attr.type=\"string\"/>\n";
   os << "  <graph id=\"network\" edgedefault=\"directed\">\n";
 
-  for (auto v : net) {
-    os << "    <node id=\"" << v.first << "\"/>\n";
+  for (vertex v = 0; v < net.order(); ++v) {
+    os << "    <node id=\"" << v << "\"><data key=\"position\">" << net.value(v)
+       << "</data></node>\n";
   }
-  for (auto v : net) {
-    for (auto e : v.second) {
-      os << "    <edge source=\"" << v.first << "\" target=\"" << e << "\"/>\n";
+  for (vertex v = 0; v < net.order(); ++v) {
+    for (auto u : net.neighbors(v)) {
+      os << "    <edge source=\"" << v << "\" target=\"" << u << "\"/>\n";
     }
   }
   os << "  </graph>\n</graphml>\n";
@@ -0,0 +1,36 @@
+#ifndef WAGNER_OCCUPANCY_HH_
+#define WAGNER_OCCUPANCY_HH_
+
+#include <vector>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/species.hh"
+
+namespace wagner {
+
+/** Index of the species living in each community of the landscape. Species
+  * keep it up to date as they gain or lose populations. */
+class occupancy {
+  std::vector<species_set> m_residents; // Indexed by vertex.
+  static const species_set m_nobody;
+
+ public:
+  /** Basic constructor. */
+  occupancy() noexcept;
+
+  /** Register species 's' at location 'v'. */
+  auto add(vertex v, species *s) noexcept -> void;
+
+  /** Remove species 's' from location 'v'. */
+  auto rmv(vertex v, species *s) noexcept -> void;
+
+  /** Species living at location 'v' (ordered like the tips of the tree). */
+  auto residents(vertex v) const noexcept -> species_set const&;
+
+  /** Number of populations at location 'v'. */
+  auto size(vertex v) const noexcept -> size_t;
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef WAGNER_OUTPUT_HH_
+#define WAGNER_OUTPUT_HH_
+
+#include <ostream>
+#include "wagner/common.hh"
+#include "wagner/model.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+
+namespace wagner {
+
+/** Format of the output files (the network is always written in graphml). */
+enum class output_format {
+  xml = 0, // w-<seed>.xml and w-species-<seed>-t<t>.xml.
+  binary = 1, // w-<seed>.bin and w-species-<seed>-t<t>.bin (see binary.hh).
+  both = 2
+};
+
+/** Parameters of a run, as recorded at the beginning of the info file. */
+struct run_info {
+  model m;
+  size_t version;
+  size_t revision;
+  size_t seed;
+  size_t t_max;
+  size_t communities;
+  double radius;
+  size_t attempts; // Attempts to build the spatial network.
+  size_t num_traits;
+  float white_noise_std;
+  sampler init;
+  boundary noise_boundary;
+  schedule migration_schedule;
+  migration_draws draws;
+  double aleph;
+  double speciation;
+  double migration;
+  double extinction;
+};
+
+/** Cut an output file back to the 'size' bytes it had when a checkpoint was
+  * taken. Return false if the file is missing or shorter than that. */
+auto cut_output(const char *path, size_t size) noexcept -> bool;
+
+/** Write the opening tag of the info file and the parameters of the run. */
+auto write_xml_header(std::ostream &os, run_info const& info) noexcept -> void;
+
+/** Write the time series of the run ('n' time steps) and the closing tag of
+  * the info file. */
+template<typename Int>
+auto write_xml_footer(std::ostream &os, const Int *speciation_per_t,
+                      const Int *extinctions_per_t, const Int *species_per_t,
+                      size_t n) noexcept -> void {
+  os << "   <speciation_per_t> ";
+  for (size_t i = 0; i < n; ++i) os << speciation_per_t[i] << ' ';
+  os << "</speciation_per_t>\n   <extinctions_per_t> ";
+  for (size_t i = 0; i < n; ++i) os << extinctions_per_t[i] << ' ';
+  os << "</extinctions_per_t>\n   <species_per_t> ";
+  for (size_t i = 0; i < n; ++i) os << species_per_t[i] << ' ';
+  os << "</species_per_t>\n";
+  os << "</wagner>\n";
+}
+
+/** Write a species in XML format: its 'n' locations, with the position of
+  * each vertex taken from 'positions', their groups, and its traits. */
+auto write_species_xml(std::ostream &os, size_t id, point const& centroid,
+                       const vertex *locations, const int *groups, size_t n,
+                       const point *positions, const float *traits,
+                       size_t num_traits) noexcept -> void;
+
+}
+
+#endif
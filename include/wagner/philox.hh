@@ -0,0 +1,106 @@
+#ifndef WAGNER_PHILOX_HH_
+#define WAGNER_PHILOX_HH_
+
+#include <cstdint>
+#include <limits>
+
+namespace wagner {
+
+/**
+  \brief Philox4x64-10, a counter-based random number engine (Salmon et al.,
+         "Parallel random numbers: as easy as 1, 2, 3", SC 2011).
+
+  The nth block of four outputs is a bijection of the counter 'n', keyed by
+  two words: any part of a stream is computed in constant time, with no state
+  shared between streams. The engine models UniformRandomBitGenerator, so it
+  works with the distributions of <random>.
+
+  A stream is named by its key and the first three words of its counter; the
+  fourth word counts the blocks of the stream (2^64 blocks). Wagner keys the
+  streams by (seed of the run, phase) and names them by (step, species,
+  location), so every sub-computation of a run draws its own numbers,
+  whatever the thread it runs on.
+ */
+class philox {
+  uint64_t m_key[2];
+  uint64_t m_counter[4];
+  uint64_t m_block[4]; // Outputs of the current counter.
+  unsigned m_used; // Outputs of the block already returned.
+
+  __extension__ typedef unsigned __int128 uint128; // Not ISO C++, hence __extension__.
+
+  static auto m_mulhilo(uint64_t a, uint64_t b, uint64_t &hi) noexcept -> uint64_t {
+    auto const p = static_cast<uint128>(a) * b;
+    hi = static_cast<uint64_t>(p >> 64);
+    return static_cast<uint64_t>(p);
+  }
+
+  auto m_next_block() noexcept -> void {
+    block(m_counter, m_key, m_block);
+    ++m_counter[3];
+    m_used = 0;
+  }
+
+ public:
+  using result_type = uint64_t;
+
+  /** The stream (s0, s1, s2) of the key (k0, k1). */
+  philox(uint64_t k0, uint64_t k1, uint64_t s0 = 0, uint64_t s1 = 0, uint64_t s2 = 0) noexcept
+    : m_key{k0, k1}, m_counter{s0, s1, s2, 0}, m_block{0, 0, 0, 0}, m_used{4} {
+    //
+  }
+
+  /** The ten rounds of Philox4x64 on the counter 'ctr' with the key 'key'. */
+  static auto block(const uint64_t ctr[4], const uint64_t key[2], uint64_t out[4]) noexcept -> void {
+    uint64_t x0 = ctr[0], x1 = ctr[1], x2 = ctr[2], x3 = ctr[3];
+    uint64_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round) {
+      uint64_t hi0, hi1;
+      auto const lo0 = m_mulhilo(0xD2E7470EE14C6C93ull, x0, hi0);
+      auto const lo1 = m_mulhilo(0xCA5A826395121157ull, x2, hi1);
+      x0 = hi1 ^ x1 ^ k0;
+      x1 = lo1;
+      x2 = hi0 ^ x3 ^ k1;
+      x3 = lo0;
+      k0 += 0x9E3779B97F4A7C15ull;
+      k1 += 0xBB67AE8584CAA73Bull;
+    }
+    out[0] = x0;
+    out[1] = x1;
+    out[2] = x2;
+    out[3] = x3;
+  }
+
+  static constexpr auto min() noexcept -> result_type {
+    return 0;
+  }
+
+  static constexpr auto max() noexcept -> result_type {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  /** The next output of the stream. */
+  auto operator()() noexcept -> result_type {
+    if (m_used == 4) {
+      m_next_block();
+    }
+    return m_block[m_used++];
+  }
+
+  /** Skip 'n' outputs, in constant time. */
+  auto discard(unsigned long long n) noexcept -> void {
+    auto const left = 4 - m_used;
+    if (n <= left) {
+      m_used += static_cast<unsigned>(n);
+      return;
+    }
+    n -= left;
+    m_counter[3] += (n - 1) / 4;
+    m_next_block();
+    m_used = static_cast<unsigned>((n - 1) % 4 + 1);
+  }
+};
+
+}
+
+#endif
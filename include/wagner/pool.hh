@@ -0,0 +1,81 @@
+#ifndef WAGNER_POOL_HH_
+#define WAGNER_POOL_HH_
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+namespace wagner {
+
+/** Slab allocator for objects of type T: objects are built in chunks of
+  * 'ChunkSize' slots, so they never move, creating one is usually a pointer
+  * bump, and destroyed slots are reused. Objects still alive when the pool is
+  * destroyed are destroyed with it. */
+template<typename T, size_t ChunkSize = 1024>
+class pool {
+  using slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  std::vector<std::unique_ptr<slot[]>> m_chunks;
+  size_t m_used; // Slots handed out in the last chunk.
+  std::vector<T*> m_free; // Destroyed slots, to reuse.
+
+ public:
+  /** Basic constructor. */
+  pool() noexcept : m_used(ChunkSize) {
+    //
+  }
+
+  pool(const pool&) = delete;
+  auto operator=(const pool&) -> pool& = delete;
+
+  /** Destroy the objects still alive and release the chunks. */
+  ~pool() noexcept {
+    // The slots come from different chunks, which only std::less orders.
+    auto const before = std::less<T*>{};
+    std::sort(m_free.begin(), m_free.end(), before);
+    for (size_t c = 0; c < m_chunks.size(); ++c) {
+      auto const n = c + 1 == m_chunks.size() ? m_used : ChunkSize;
+      for (size_t i = 0; i < n; ++i) {
+        auto p = reinterpret_cast<T*>(&m_chunks[c][i]);
+        if (!std::binary_search(m_free.begin(), m_free.end(), p, before)) {
+          p->~T();
+        }
+      }
+    }
+  }
+
+  /** Build an object in the pool. */
+  template<typename... Args>
+  auto create(Args&&... args) -> T* {
+    void *p;
+    if (!m_free.empty()) {
+      p = m_free.back();
+      m_free.pop_back();
+    } else {
+      if (m_used == ChunkSize) {
+        m_chunks.emplace_back(new slot[ChunkSize]);
+        m_used = 0;
+      }
+      p = &m_chunks.back()[m_used++];
+    }
+    return new (p) T(std::forward<Args>(args)...);
+  }
+
+  /** Destroy an object built by this pool. */
+  auto destroy(T *p) noexcept -> void {
+    p->~T();
+    m_free.push_back(p);
+  }
+
+  /** Number of objects alive. */
+  auto size() const noexcept -> size_t {
+    return m_chunks.empty() ? 0 : (m_chunks.size() - 1) * ChunkSize + m_used - m_free.size();
+  }
+};
+
+}
+
+#endif
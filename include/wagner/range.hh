@@ -0,0 +1,307 @@
+#ifndef WAGNER_RANGE_HH_
+#define WAGNER_RANGE_HH_
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+
+namespace wagner {
+
+/** The range of a species: the set of vertices where it is present, each with
+  * the label of the group (connected component) it belongs to. Both layouts
+  * below share the same interface and iterate vertices in increasing order, so
+  * they give identical simulations. */
+
+/** Range stored as a sorted vertex -> group map. Memory is proportional to the
+  * number of populations. */
+class map_range {
+  map<vertex, int> m_labels;
+#ifdef WAGNER_NOBOOST
+  std::vector<vertex> m_sorted; // The vertices in order, for nth (std::map has no index).
+#endif
+
+ public:
+  class const_iterator {
+    map<vertex, int>::const_iterator m_it;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = vertex;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const vertex*;
+    using reference = vertex;
+
+    explicit const_iterator(map<vertex, int>::const_iterator it) noexcept : m_it(it) {
+      //
+    }
+
+    auto operator*() const noexcept -> vertex {
+      return m_it->first;
+    }
+
+    auto operator++() noexcept -> const_iterator& {
+      ++m_it;
+      return *this;
+    }
+
+    auto operator==(const const_iterator &it) const noexcept -> bool {
+      return m_it == it.m_it;
+    }
+
+    auto operator!=(const const_iterator &it) const noexcept -> bool {
+      return m_it != it.m_it;
+    }
+  };
+
+  /** Number of populations. */
+  auto size() const noexcept -> size_t {
+    return m_labels.size();
+  }
+
+  /** True if the range is empty. */
+  auto empty() const noexcept -> bool {
+    return m_labels.empty();
+  }
+
+  /** True if 'v' is in the range. */
+  auto contains(vertex v) const noexcept -> bool {
+    return m_labels.find(v) != m_labels.end();
+  }
+
+  /** Add 'v' to the range, with no group (-1). */
+  auto insert(vertex v) noexcept -> void {
+#ifdef WAGNER_NOBOOST
+    auto const at = std::lower_bound(m_sorted.begin(), m_sorted.end(), v);
+    if (at == m_sorted.end() || *at != v) {
+      m_sorted.insert(at, v);
+    }
+#endif
+    m_labels[v] = -1;
+  }
+
+  /** Remove 'v' from the range. */
+  auto erase(vertex v) noexcept -> void {
+#ifdef WAGNER_NOBOOST
+    if (m_labels.erase(v) != 0) {
+      m_sorted.erase(std::lower_bound(m_sorted.begin(), m_sorted.end(), v));
+    }
+#else
+    m_labels.erase(v);
+#endif
+  }
+
+  /** The ith vertex, in increasing order, in constant time. Without boost, the
+    * vertices are also kept in a sorted vector for this, so insert and erase
+    * move the vertices after the one changed, as a flat map does. */
+  auto nth(size_t i) const noexcept -> vertex {
+#ifdef WAGNER_NOBOOST
+    return m_sorted[i];
+#else
+    return (m_labels.begin() + i)->first;
+#endif
+  }
+
+  /** Group of vertex 'v' (must be in the range). */
+  auto label(vertex v) const noexcept -> int {
+    return m_labels.find(v)->second;
+  }
+
+  /** Set the group of vertex 'v' (must be in the range). */
+  auto set_label(vertex v, int g) noexcept -> void {
+    m_labels.find(v)->second = g;
+  }
+
+  /** Vertices found in both ranges, in increasing order. */
+  auto operator&(const map_range &r) const noexcept -> std::vector<vertex> {
+    std::vector<vertex> vs;
+    for (auto const& l : m_labels) {
+      if (r.contains(l.first)) {
+        vs.push_back(l.first);
+      }
+    }
+    return vs;
+  }
+
+  /** Number of vertices found in both ranges. */
+  auto common(const map_range &r) const noexcept -> size_t {
+    size_t n = 0;
+    for (auto const& l : m_labels) {
+      n += r.contains(l.first);
+    }
+    return n;
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return const_iterator(m_labels.begin());
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return const_iterator(m_labels.end());
+  }
+};
+
+/** Range stored as a dense bitset over the vertices of the landscape, with a
+  * parallel array of group labels. Presence tests are a bit test, co-occurrence
+  * a word-wise AND, and memory is proportional to the size of the landscape.
+  * The bitset grows as needed. */
+class bitset_range {
+  std::vector<uint64_t> m_bits;
+  std::vector<int> m_labels; // 64 labels per word of m_bits.
+  size_t m_count; // Number of bits set.
+
+ public:
+  class const_iterator {
+    const uint64_t *m_words;
+    size_t m_nwords;
+    size_t m_word; // Index of the current word.
+    uint64_t m_rest; // Bits of the current word not visited yet.
+
+    auto m_skip() noexcept -> void {
+      while (m_rest == 0 && m_word < m_nwords) {
+        if (++m_word < m_nwords) {
+          m_rest = m_words[m_word];
+        }
+      }
+    }
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = vertex;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const vertex*;
+    using reference = vertex;
+
+    const_iterator(const uint64_t *words, size_t nwords, size_t word) noexcept
+      : m_words(words), m_nwords(nwords), m_word(word),
+        m_rest(word < nwords ? words[word] : 0) {
+      m_skip();
+    }
+
+    auto operator*() const noexcept -> vertex {
+      return (vertex)(m_word * 64 + __builtin_ctzll(m_rest));
+    }
+
+    auto operator++() noexcept -> const_iterator& {
+      m_rest &= m_rest - 1;
+      m_skip();
+      return *this;
+    }
+
+    auto operator==(const const_iterator &it) const noexcept -> bool {
+      return m_word == it.m_word && m_rest == it.m_rest;
+    }
+
+    auto operator!=(const const_iterator &it) const noexcept -> bool {
+      return !(*this == it);
+    }
+  };
+
+  bitset_range() noexcept : m_count(0) {
+    //
+  }
+
+  /** Number of populations. */
+  auto size() const noexcept -> size_t {
+    return m_count;
+  }
+
+  /** True if the range is empty. */
+  auto empty() const noexcept -> bool {
+    return m_count == 0;
+  }
+
+  /** True if 'v' is in the range. */
+  auto contains(vertex v) const noexcept -> bool {
+    auto const w = v >> 6;
+    return w < m_bits.size() && (m_bits[w] >> (v & 63)) & 1u;
+  }
+
+  /** Add 'v' to the range, with no group (-1). */
+  auto insert(vertex v) noexcept -> void {
+    auto const w = v >> 6;
+    if (w >= m_bits.size()) {
+      m_bits.resize(w + 1, 0);
+      m_labels.resize(64 * (w + 1), -1);
+    }
+    uint64_t const bit = uint64_t{1} << (v & 63);
+    m_count += (m_bits[w] & bit) == 0;
+    m_bits[w] |= bit;
+    m_labels[v] = -1;
+  }
+
+  /** Remove 'v' from the range. */
+  auto erase(vertex v) noexcept -> void {
+    auto const w = v >> 6;
+    if (w < m_bits.size()) {
+      uint64_t const bit = uint64_t{1} << (v & 63);
+      m_count -= (m_bits[w] & bit) != 0;
+      m_bits[w] &= ~bit;
+    }
+  }
+
+  /** The ith vertex, in increasing order (skips whole words). */
+  auto nth(size_t i) const noexcept -> vertex {
+    size_t w = 0;
+    for (size_t c; (c = __builtin_popcountll(m_bits[w])) <= i; ++w) {
+      i -= c;
+    }
+    auto x = m_bits[w];
+    for (; i > 0; --i) {
+      x &= x - 1;
+    }
+    return (vertex)(w * 64 + __builtin_ctzll(x));
+  }
+
+  /** Group of vertex 'v' (must be in the range). */
+  auto label(vertex v) const noexcept -> int {
+    return m_labels[v];
+  }
+
+  /** Set the group of vertex 'v' (must be in the range). */
+  auto set_label(vertex v, int g) noexcept -> void {
+    m_labels[v] = g;
+  }
+
+  /** Vertices found in both ranges, in increasing order. */
+  auto operator&(const bitset_range &r) const noexcept -> std::vector<vertex> {
+    std::vector<vertex> vs;
+    auto const n = min2(m_bits.size(), r.m_bits.size());
+    for (size_t w = 0; w < n; ++w) {
+      for (uint64_t x = m_bits[w] & r.m_bits[w]; x != 0; x &= x - 1) {
+        vs.push_back((vertex)(w * 64 + __builtin_ctzll(x)));
+      }
+    }
+    return vs;
+  }
+
+  /** Number of vertices found in both ranges. */
+  auto common(const bitset_range &r) const noexcept -> size_t {
+    size_t c = 0;
+    auto const n = min2(m_bits.size(), r.m_bits.size());
+    for (size_t w = 0; w < n; ++w) {
+      c += __builtin_popcountll(m_bits[w] & r.m_bits[w]);
+    }
+    return c;
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return const_iterator(m_bits.data(), m_bits.size(), 0);
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return const_iterator(m_bits.data(), m_bits.size(), m_bits.size());
+  }
+};
+
+#ifdef WAGNER_BITSET_RANGE
+  using range = bitset_range;
+#else
+  using range = map_range;
+#endif
+
+}
+
+#endif
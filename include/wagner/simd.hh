@@ -0,0 +1,46 @@
+#ifndef WAGNER_SIMD_HH_
+#define WAGNER_SIMD_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wagner {
+
+/** Vectorized kernels over arrays of floats (SSE2, AVX2 or AVX-512 on x86-64,
+  * scalar elsewhere), chosen at runtime for the CPU.
+  *
+  * Every implementation accumulates element i in lane i % 16 and adds the 16
+  * lanes up in the same order, without fused multiply-adds, so all of them
+  * return exactly the same values: results do not depend on the machine.
+  *
+  * This order is not the one of a loop adding the elements one after the
+  * other, as former versions did: a sum can differ from theirs in the last
+  * bit. The trait distances of a run, hence its outputs, may then differ from
+  * those of former versions for the same seed. The rejection samplers keep
+  * the sequential sum (see in_sphere) and replay their streams. */
+namespace simd {
+
+/** Name of the implementation in use ("avx512", "avx2", "sse2" or "scalar"). */
+auto isa() noexcept -> const char*;
+
+/** Sum of (xs[i] - ys[i])^2 for i < n. */
+auto squared_distance(const float *xs, const float *ys, size_t n) noexcept -> float;
+
+/** Sum of xs[i]^2 for i < n. */
+auto squared_norm(const float *xs, size_t n) noexcept -> float;
+
+/** One against many: out[k] is the Euclidean distance between 'x' and the row
+  * base + rows[k] * stride, over n values, for k < m. */
+auto distances(const float *x, const float *base, size_t stride,
+               const size_t *rows, size_t m, size_t n, float *out) noexcept -> void;
+
+/** Uniform draws on [0, 1) from the 64-bit outputs xs[i] of an engine, for
+  * i < n: the values std::uniform_real_distribution<double> draws from them
+  * (libstdc++), x * 2^-64 with x rounded to the nearest double, below 1. */
+auto uniforms(const uint64_t *xs, size_t n, double *out) noexcept -> void;
+
+}
+
+}
+
+#endif
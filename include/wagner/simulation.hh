@@ -3,6 +3,8 @@
 
 #include "wagner/model.hh"
 #include "wagner/common.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/output.hh"
 
 namespace wagner {
 
@@ -20,11 +22,43 @@ namespace wagner {
   \param speciation         Speciation rate.
   \param radius             Threshold distance for the spatial network (higher: more connected landscapes).
   \param white_noise_std    Standard deviation of the white noise applied to all traits.
+  \param init               How the traits of the first species are drawn.
+  \param noise_boundary     What the white noise does at the edge of the trait sphere.
+  \param format             Format of the output files.
+  \param migration_threads  Threads for the migration phase. With 0, the species
+                            migrate one after the other (schedule::sequential).
+                            Otherwise the phase is synchronous (see
+                            synchronous_migration), with the same results for
+                            any number of threads.
+  \param draws              Random draws of the migration phase.
+  \param checkpoint_interval Time steps between two checkpoints of the run, in
+                            w-<seed>.ckpt (see checkpoint.hh); none with 0.
  */
 void simulation(model m, size_t seed, size_t t_max, size_t communities,
                 size_t traits, double ext_max, double mig_max,
                 double aleph, double speciation, double radius,
-                float white_noise_std) noexcept;
+                float white_noise_std, sampler init = sampler::rejection,
+                boundary noise_boundary = boundary::rejection,
+                output_format format = output_format::xml,
+                size_t migration_threads = 0,
+                migration_draws draws = migration_draws::per_trial,
+                size_t checkpoint_interval = 0) noexcept;
+
+/**
+  \brief Resume a simulation from a checkpoint: it goes on exactly as if it had
+         not stopped, and what its files got after the checkpoint is dropped.
+
+  \param path               The checkpoint (w-<seed>.ckpt).
+  \param migration_threads  Threads for the migration phase if the run has the
+                            synchronous schedule (0: as before). The schedule
+                            itself does not change.
+  \param checkpoint_interval Time steps between two checkpoints (0: as before).
+  \return                   False if the checkpoint cannot be read, or if the
+                            output files of the run cannot be cut back and
+                            reopened (the run is not resumed).
+ */
+auto resume(const char *path, size_t migration_threads = 0,
+            size_t checkpoint_interval = 0) noexcept -> bool;
 
 }
 
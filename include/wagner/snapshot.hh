@@ -0,0 +1,106 @@
+#ifndef WAGNER_SNAPSHOT_HH_
+#define WAGNER_SNAPSHOT_HH_
+
+#include <ostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "wagner/common.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/output.hh"
+
+namespace wagner {
+
+class species;
+class speciestree;
+
+/** What is written about an extant species, copied from it so it can be
+  * written while the simulation goes on. */
+struct species_record {
+  size_t id;
+  std::vector<vertex> locations;
+  std::vector<int> groups; // Group of each location.
+  std::vector<float> traits;
+
+  /** Copy the state of a species, reusing the memory of the record. */
+  auto capture(const species &s) noexcept -> void;
+
+  /** Centroid of the locations (see species::centroid). */
+  auto centroid(network<point> const& landscape) const noexcept -> point;
+
+  /** Write the record in XML format (see species::get_info). */
+  auto write(std::ostream &os, network<point> const& landscape) const noexcept -> void;
+};
+
+/** The extant species of a tree at a given time. */
+class snapshot {
+  size_t m_t;
+  std::vector<species_record> m_records; // Only the first m_size are used.
+  size_t m_size;
+
+ public:
+  /** Basic constructor (empty snapshot). */
+  snapshot() noexcept;
+
+  /** Copy the extant species of the tree at time 't'. The records of the
+    * previous capture are reused. */
+  auto capture(const speciestree &tree, size_t t) noexcept -> void;
+
+  /** Time of the snapshot. */
+  auto t() const noexcept -> size_t;
+
+  /** Number of species. */
+  auto size() const noexcept -> size_t;
+
+  /** Write the snapshot in XML format: the content of a w-species file. */
+  auto write(std::ostream &os, network<point> const& landscape) const noexcept -> void;
+
+  /** Write the snapshot in the binary format of binary.hh. */
+  auto write_binary(std::ostream &os, network<point> const& landscape) const noexcept -> void;
+};
+
+/**
+  \brief Writes the w-species-<seed>-t<t> files in a background thread.
+
+  The writer owns two snapshots: the simulation copies the tree into one of
+  them and goes on while the other one is formatted and written. The
+  simulation only waits if it takes a new snapshot before the one before the
+  last is written. The landscape must outlive the writer.
+ */
+class snapshot_writer {
+  network<point> const& m_landscape;
+  size_t m_seed;
+  output_format m_format;
+  snapshot m_buffers[2];
+  int m_fill; // Buffer the next snapshot goes to.
+  int m_queued; // Buffer waiting to be written, or -1.
+  int m_writing; // Buffer being written, or -1.
+  bool m_stop;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::thread m_thread;
+  auto m_run() noexcept -> void;
+
+ public:
+  /** Start the thread. */
+  snapshot_writer(network<point> const& landscape, size_t seed,
+                  output_format format = output_format::xml) noexcept;
+
+  snapshot_writer(const snapshot_writer&) = delete;
+  auto operator=(const snapshot_writer&) -> snapshot_writer& = delete;
+
+  /** Write the snapshots still queued, then stop the thread. */
+  ~snapshot_writer() noexcept;
+
+  /** Take a snapshot of the tree at time 't' and queue it for writing. */
+  auto write(const speciestree &tree, size_t t) noexcept -> void;
+
+  /** Wait until the snapshots queued so far are written. */
+  auto wait() noexcept -> void;
+};
+
+}
+
+#endif
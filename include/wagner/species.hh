@@ -4,44 +4,61 @@
 #include <iostream>
 #include <set>
 #include <vector>
+#include <utility>
 #include "wagner/common.hh"
 #include "wagner/tbranch.hh"
 #include "wagner/network.hh"
 #include "wagner/point.hh"
+#include "wagner/range.hh"
+#include "wagner/traits.hh"
 
 namespace wagner {
 
+class occupancy;
+
 /** Species as the leaf of a phylogenetic tree. */
 class species : public tbranch {
-  std::vector<float> m_traits;
-  map<point, int> m_locations; // Location/group map.
-  auto m_grouping(const point &p, int gid, network<point> &n) noexcept -> void; // Recursive function used to establish the groups.
-  size_t m_groups; // Number of groups.
+  trait_matrix *m_traits; // Traits of the species of the tree (may be null).
+  range m_locations; // Locations and the label of their group.
+  std::vector<vertex> m_added; // Locations added since the last up_groups.
+  std::vector<std::pair<vertex, int>> m_removed; // Labelled locations removed since then.
+  std::vector<size_t> m_label_sizes; // Number of locations with each label (0 if unused).
+  std::vector<vertex> m_label_mins; // Smallest location with each label.
+  std::vector<int> m_free_labels; // Unused labels.
+  std::vector<int> m_groups; // Label of each group, as of the last up_groups.
+  std::vector<int> m_group_of; // Group of each label, as of the last up_groups.
+  auto m_new_label() noexcept -> int;
+  auto m_relabel(vertex v, int from, int to, network<point> const& n,
+                 std::vector<vertex> &queue) noexcept -> void; // Flood fill.
+  occupancy *m_occupancy; // Landscape-wide index of residents (may be null).
+  size_t m_slot; // Dense index given by the speciestree.
 
  public:
   /** Unique ID of the species. */
   const size_t id;
 
-  /** Basic constructor. */
-  species(size_t i, size_t ntraits = 0) noexcept;
+  /** Basic constructor. The traits of the species are row 'slot' of 'traits'
+    * (no traits if null). */
+  species(size_t i, trait_matrix *traits = nullptr, occupancy *occ = nullptr,
+          size_t slot = 0) noexcept;
 
-  /** Creates a species with a starting set of traits. */
-  species(size_t i, std::vector<float> const& starting_traits) noexcept;
+  /** Dense index of the species among the extant species of its tree. */
+  auto slot() const noexcept -> size_t;
 
   /** Returns the number of traits. */
   auto num_traits() const noexcept -> size_t;
 
-  /** Returns a reference to the trait vector. */
-  auto traits() noexcept -> std::vector<float>&;
+  /** Returns a view of the traits (a row of the tree's trait matrix). */
+  auto traits() noexcept -> traits_view;
 
   /** Get the value of the nth trait. */
   auto operator[](size_t idx) noexcept -> float&;
 
   /** Iterate over the specie' traits. */
-  auto begin() const noexcept -> std::vector<float>::const_iterator;
+  auto begin() const noexcept -> const float*;
 
-  /** End of the vector of traits. */
-  auto end() const noexcept -> std::vector<float>::const_iterator;
+  /** End of the traits. */
+  auto end() const noexcept -> const float*;
 
   /** Return true if extinct. */
   auto extinct() const noexcept -> bool;
@@ -53,27 +70,33 @@ class species : public tbranch {
   auto num_groups() const noexcept -> size_t;
 
   /** Take a pointer to a spatial network, update the groups, return the number
-    * of groups. */
-  auto up_groups(network<point> &n) noexcept -> size_t;
+    * of groups. Groups are maintained incrementally: components touched by an
+    * added location are merged (the smaller one is relabelled), and only the
+    * components that lost a location are relabelled. Groups are numbered in
+    * increasing order of their smallest location. */
+  auto up_groups(network<point> const& n) noexcept -> size_t;
+
+  /** Group of location 'v', or -1 if it was added after the last up_groups. */
+  auto group(vertex v) const noexcept -> int;
 
   /** Pop the gth group (that is: store the set of locations in a set, remove
     * them from this species and return it. */
-  auto pop_group(int g) noexcept -> set<point>;
+  auto pop_group(int g) noexcept -> set<vertex>;
 
   /** Return the set of locations. */
-  auto get_locations() const noexcept -> map<point, int> const&;
+  auto get_locations() const noexcept -> range const&;
 
   /** Test if the species is at the given location. */
-  auto is_in(const point &p) const noexcept -> bool;
+  auto is_in(vertex v) const noexcept -> bool;
 
   /** Add a location to the species. */
-  auto add_to(const point &p) noexcept -> void;
+  auto add_to(vertex v) noexcept -> void;
 
   /** Add a location to the species. */
-  auto add_to(const set<point> &ps) noexcept -> void;
+  auto add_to(const set<vertex> &vs) noexcept -> void;
 
   /** Remove the species from a location. */
-  auto rmv_from(const point &p) noexcept -> void;
+  auto rmv_from(vertex v) noexcept -> void;
 
   /** Number of different traits from another species. */
   auto num_differences(const species &s) const noexcept -> size_t;
@@ -88,16 +111,22 @@ class species : public tbranch {
   auto get_mrca(const set<tbranch*> &ps) const noexcept -> size_t;
 
   /** Return the set of locations where both species are found (co-occurence). */
-  auto operator&(species &s) const noexcept -> set<point>;
+  auto operator&(species &s) const noexcept -> set<vertex>;
+
+  /** Number of locations where both species are found. */
+  auto co_occurrences(const species &s) const noexcept -> size_t;
 
   /** Return the species' name. */
   auto name() const noexcept -> std::string;
 
+  /** Centroid of the species' range on the landscape. */
+  auto centroid(network<point> const& n) const noexcept -> point;
+
   /** Get info on the species in XML format. */
-  auto get_info(size_t time) const noexcept -> std::string;
+  auto get_info(size_t time, network<point> const& landscape) const noexcept -> std::string;
 
-  /** Return in newick format. */
-  virtual std::string newick() const noexcept;
+  /** Name of the species in Newick format. */
+  virtual auto write_name(std::ostream &os) const noexcept -> void;
 
   // Use the ID to test equality and order:
   auto operator==(const species &s) const noexcept -> bool;
@@ -109,6 +138,17 @@ class species : public tbranch {
   friend auto operator<<(std::ostream &os, const species &s) noexcept -> std::ostream&;
 };
 
+/** Orders species by ID, so iterating a set of species does not depend on
+  * where they were allocated. */
+struct by_id {
+  auto operator()(const species *s0, const species *s1) const noexcept -> bool {
+    return s0->id < s1->id;
+  }
+};
+
+/** A set of species ordered by ID. */
+using species_set = set<species*, by_id>;
+
 }
 
 #endif
@@ -2,33 +2,93 @@
 #define WAGNER_SPECIESTREE_HH_
 
 #include <ostream>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include <random>
 #include "wagner/common.hh"
 #include "wagner/tbranch.hh"
 #include "wagner/species.hh"
 #include "wagner/point.hh"
+#include "wagner/occupancy.hh"
+#include "wagner/distances.hh"
+#include "wagner/traits.hh"
+#include "wagner/mrca.hh"
+#include "wagner/pool.hh"
 
 namespace wagner {
 
+/** A speciestree as flat arrays, the way checkpoints store it (see
+  * checkpoint.hh). The nodes are listed in preorder, left child first, and the
+  * species in the order of the leaves. */
+struct tree_columns {
+  size_t start_date;
+  size_t id_count; // Ids handed out so far.
+  size_t num_slots; // Slots handed out so far.
+  size_t num_free_slots;
+  const uint64_t *free_slots; // In the order they are reused, last first.
+  size_t num_nodes;
+  const uint64_t *end_dates; // Of the nodes.
+  const uint8_t *leaves; // 1 for the leaves, 0 for the internal nodes.
+  size_t num_species;
+  const uint64_t *ids;
+  const uint64_t *slots;
+  const uint64_t *first_location; // num_species + 1 indices in 'locations'.
+  const uint32_t *locations;
+  size_t num_traits;
+  const float *traits; // One row of num_traits per species.
+};
+
 /** An object to store species and their phylogeny. */
 class speciestree {
+  pool<tbranch> m_branches; // Storage for the internal nodes.
+  pool<species> m_species; // Storage for the species (extant or not).
   tbranch* m_root;
-  set<species*> m_tips; // The tips of the tree (the extant species).
+  species_set m_tips; // The tips of the tree (the extant species).
   size_t m_start_date; // Start date of the tree.
   size_t m_id_count; // Counter to name species.
+  occupancy m_occupancy; // Species found in each community.
+  std::vector<size_t> m_free_slots; // Slots released by extinct species.
+  size_t m_num_slots; // Number of slots handed out so far.
+  trait_matrix m_traits; // Traits of the extant species, by slot.
+  distance_matrix m_distances; // Trait distances between extant species.
+  bool m_track_distances; // True once update_distances has been called.
+  mrca_index m_mrca; // Most-recent-common-ancestor queries.
+  bool m_mrca_dirty; // True if the tree changed since m_mrca was built.
+  auto m_take_slot() noexcept -> size_t;
 
  public:
   /** Basic constructor. Creates a species with its initial vector of traits and place it at the root. */
   speciestree(std::vector<float> const& traits) noexcept;
 
-  /** Basic destructor. */
+  /** Rebuild a saved tree. The distances are not saved: call update_distances
+    * to track them again. */
+  explicit speciestree(tree_columns const& c) noexcept;
+
+  /** Basic destructor: frees all the nodes at once. */
   ~speciestree() noexcept;
 
   /** Number of species in the tree. */
   auto num_species() noexcept -> size_t;
 
-  /** Remove extinct species. */
-  auto rmv_extinct(size_t date) noexcept -> set<species*>;
+  /** Root of the tree (null once every species is extinct). */
+  auto root() const noexcept -> const tbranch*;
+
+  /** Start date of the tree. */
+  auto start_date() const noexcept -> size_t;
+
+  /** Number of ids handed out so far (the id of the next species). */
+  auto id_count() const noexcept -> size_t;
+
+  /** Number of slots handed out so far. */
+  auto num_slots() const noexcept -> size_t;
+
+  /** Slots released by extinct species, the next one to reuse last. */
+  auto free_slots() const noexcept -> std::vector<size_t> const&;
+
+  /** Remove extinct species and the nodes they leave behind, return the
+    * number of species removed. */
+  auto rmv_extinct(size_t date) noexcept -> size_t;
 
   /** Speciate. */
   auto speciate(species *parent, size_t date) noexcept -> species*;
@@ -39,11 +99,38 @@ class speciestree {
   /** Return the tree in Newick format. */
   auto newick() const noexcept -> std::string;
 
+  /** Write the tree in Newick format to a stream (see tbranch::write_newick). */
+  auto write_newick(std::ostream &os) const noexcept -> void;
+
+  /** Traits of the extant species, one row per slot. */
+  auto traits() noexcept -> trait_matrix&;
+
+  /** Apply white noise to the traits of all extant species, in the order of
+    * their ids (see trait_matrix::white_noise). */
+  auto white_noise(std::mt19937_64& rng, std::normal_distribution<float>& d,
+                   float radius = 0.5f, boundary b = boundary::rejection) noexcept -> void;
+
+  /** Compute the trait distances between all extant species. From then on,
+    * the matrix also follows speciation and extinction events. */
+  auto update_distances() noexcept -> void;
+
+  /** Cached trait distance between two extant species (see update_distances). */
+  auto distance(const species &s0, const species &s1) const noexcept -> float {
+    return m_distances(s0.slot(), s1.slot());
+  }
+
+  /** Date of the most recent common ancestor of two extant species. The
+    * index is rebuilt lazily after the tree changes, queries are O(1). */
+  auto mrca(const species &s0, const species &s1) noexcept -> size_t;
+
+  /** Extant species living at location 'v'. */
+  auto residents(vertex v) const noexcept -> species_set const&;
+
   // Iterate the tips of the tree (the extant species):
-  auto begin() noexcept -> set<species*>::iterator;
-  auto end() noexcept -> set<species*>::iterator;
-  auto begin() const noexcept -> set<species*>::const_iterator;
-  auto end() const noexcept -> set<species*>::const_iterator;
+  auto begin() noexcept -> species_set::iterator;
+  auto end() noexcept -> species_set::iterator;
+  auto begin() const noexcept -> species_set::const_iterator;
+  auto end() const noexcept -> species_set::const_iterator;
 
   /** Return the tree in Newick format. */
   friend auto operator<<(std::ostream &os, const speciestree &t) noexcept -> std::ostream&;
@@ -20,12 +20,20 @@ class tbranch {
   tbranch* m_left;
   // "Right" children:
   tbranch* m_right;
+  // Position in the Euler tour of the tree (see mrca_index):
+  size_t m_euler;
+  // Cached aggregates of the subtree, valid unless m_stale (see invalidate):
+  mutable size_t m_edges;
+  mutable size_t m_level;
+  mutable size_t m_max_end_date;
+  mutable bool m_stale;
+  auto m_update() const noexcept -> void; // Recompute the stale aggregates.
 
  public:
   /** Basic constructor. */
   tbranch(tbranch *p = nullptr, tbranch *l = nullptr, tbranch *r = nullptr) noexcept;
 
-  /** Resursive destructor. */
+  /** Basic destructor (the nodes of a tree are owned by its speciestree). */
   virtual ~tbranch();
 
   /** Return the parent. */
@@ -46,6 +54,11 @@ class tbranch {
   /** Set the right child. */
   auto set_right(tbranch *t) noexcept -> void;
 
+  /** Mark the cached aggregates of the node and its ancestors as stale (the
+    * walk stops at the first ancestor already stale). Call it after relinking
+    * nodes; the aggregates are recomputed by the next query that needs them. */
+  auto invalidate() noexcept -> void;
+
   /** Return true if the node is a root. */
   auto root() const noexcept -> bool;
 
@@ -55,28 +68,29 @@ class tbranch {
   /** Return true for internal nodes. */
   auto internal() const noexcept -> bool;
 
-  /** A recursive algorithm to test if the tree is strictly binary. */
+  /** Test if the tree is strictly binary. */
   auto strictly_binary() const noexcept -> bool;
 
   /** Distance between this node and its parent. */
   auto parent_distance() const noexcept -> size_t;
 
-  /** Return the distance from the node to the beginning of the tree. */
+  /** Return the distance from the node to the beginning of the tree, in
+    * O(depth). */
   auto total_distance() const noexcept -> size_t;
 
-  /** Return the number of nodes from the root to this node. */
+  /** Return the number of nodes from the root to this node, in O(depth). */
   auto nodes() const noexcept -> size_t;
 
-  /** Return the number of edges in the subtree. */
+  /** Return the number of edges in the subtree (cached, O(1) unless the subtree changed). */
   auto edges() const noexcept -> size_t;
 
-  /** Return the number of leaves (i.e.: species) in the subtree. */
+  /** Return the number of leaves (i.e.: species) in the subtree (cached, O(1) unless the subtree changed). */
   auto leaves() const noexcept -> size_t;
 
-  /** Max end date in the subtree. */
+  /** Max end date of the leaves of the subtree (cached, O(1) unless the subtree changed). */
   auto max_end_date() const noexcept -> size_t;
 
-  /** The level of the node as defined by Huson et al. */
+  /** The level of the node as defined by Huson et al. (cached, O(1) unless the subtree changed). */
   auto level() const noexcept -> size_t;
 
   /** Return the end date. */
@@ -85,8 +99,21 @@ class tbranch {
   /** Set the end date. */
   auto set_end_date(size_t date) noexcept -> void;
 
-  /** Recursive function to get the Newick format. */
-  virtual std::string newick() const noexcept;
+  /** Position of the node in the last Euler tour of its tree. */
+  auto euler() const noexcept -> size_t;
+
+  /** Set the position of the node in the Euler tour. */
+  auto set_euler(size_t pos) noexcept -> void;
+
+  /** Return the subtree in Newick format. */
+  auto newick() const noexcept -> std::string;
+
+  /** Write the subtree in Newick format to a stream. The tree is walked
+    * through the parent links: no recursion and no allocation. */
+  auto write_newick(std::ostream &os) const noexcept -> void;
+
+  /** Name of the node in Newick format (only leaves are named). */
+  virtual auto write_name(std::ostream &os) const noexcept -> void;
 };
 
 }
@@ -0,0 +1,62 @@
+#ifndef WAGNER_THREAD_POOL_HH_
+#define WAGNER_THREAD_POOL_HH_
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <utility>
+
+namespace wagner {
+
+/**
+  \brief A fixed number of worker threads pulling tasks from a shared queue.
+
+  Tasks run in the order they are submitted, each one on the first worker
+  that is free, so long and short tasks balance across the workers. The
+  workers are started once and reused for all the tasks.
+ */
+class thread_pool {
+  std::deque<std::function<void()>> m_tasks;
+  size_t m_running; // Tasks taken by a worker and not finished yet.
+  bool m_stop;
+  std::mutex m_mutex;
+  std::condition_variable m_work; // Signals new tasks and the stop.
+  std::condition_variable m_done; // Signals finished tasks.
+  std::vector<std::thread> m_workers;
+  auto m_run() noexcept -> void;
+
+ public:
+  /** Start 'n' workers (at least one). */
+  explicit thread_pool(size_t n) noexcept;
+
+  thread_pool(const thread_pool&) = delete;
+  auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+  /** Run the tasks still queued, then stop the workers. */
+  ~thread_pool() noexcept;
+
+  /** Number of workers. */
+  auto size() const noexcept -> size_t {
+    return m_workers.size();
+  }
+
+  /** Queue a task, called without arguments by one of the workers. */
+  template<typename F>
+  auto submit(F &&task) -> void {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tasks.emplace_back(std::forward<F>(task));
+    }
+    m_work.notify_one();
+  }
+
+  /** Wait until all the tasks submitted so far are finished. */
+  auto wait() noexcept -> void;
+};
+
+}
+
+#endif
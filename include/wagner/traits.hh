@@ -0,0 +1,158 @@
+#ifndef WAGNER_TRAITS_HH_
+#define WAGNER_TRAITS_HH_
+
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#include "wagner/common.hh"
+#include "wagner/n-sphere.hh"
+
+namespace wagner {
+
+/** Allocator for vectors whose data must be aligned on 'Align' bytes. */
+template<typename T, size_t Align = 64>
+struct aligned_allocator {
+  using value_type = T;
+
+  template<typename U>
+  struct rebind {
+    using other = aligned_allocator<U, Align>;
+  };
+
+  aligned_allocator() noexcept {
+    //
+  }
+
+  template<typename U>
+  aligned_allocator(const aligned_allocator<U, Align>&) noexcept {
+    //
+  }
+
+  auto allocate(size_t n) -> T* {
+    void *p = nullptr;
+    if (posix_memalign(&p, Align, n * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  auto deallocate(T *p, size_t) noexcept -> void {
+    std::free(p);
+  }
+
+  template<typename U>
+  auto operator==(const aligned_allocator<U, Align>&) const noexcept -> bool {
+    return true;
+  }
+
+  template<typename U>
+  auto operator!=(const aligned_allocator<U, Align>&) const noexcept -> bool {
+    return false;
+  }
+};
+
+/** A view of the traits of one species: a row of a trait_matrix. It is
+  * invalidated when the matrix grows. */
+class traits_view {
+  float *m_data;
+  size_t m_size;
+
+ public:
+  traits_view(float *data, size_t size) noexcept : m_data(data), m_size(size) {
+    //
+  }
+
+  /** Number of traits. */
+  auto size() const noexcept -> size_t {
+    return m_size;
+  }
+
+  auto data() const noexcept -> float* {
+    return m_data;
+  }
+
+  auto operator[](size_t i) const noexcept -> float& {
+    return m_data[i];
+  }
+
+  auto begin() const noexcept -> float* {
+    return m_data;
+  }
+
+  auto end() const noexcept -> float* {
+    return m_data + m_size;
+  }
+};
+
+/** The traits of all extant species in one contiguous matrix, one row per
+  * slot of the speciestree. Rows are padded to a multiple of 16 floats and
+  * aligned on 64 bytes; the padding is kept at zero. */
+class trait_matrix {
+  std::vector<float, aligned_allocator<float>> m_x; // m_rows * m_stride.
+  size_t m_ntraits; // Number of traits.
+  size_t m_stride; // Floats per row.
+  size_t m_rows; // Number of rows available.
+
+ public:
+  /** Basic constructor (no rows). */
+  explicit trait_matrix(size_t ntraits = 0) noexcept;
+
+  /** Number of traits per species. */
+  auto num_traits() const noexcept -> size_t {
+    return m_ntraits;
+  }
+
+  /** Distance, in floats, between two rows. */
+  auto stride() const noexcept -> size_t {
+    return m_stride;
+  }
+
+  /** Number of rows available. */
+  auto capacity() const noexcept -> size_t {
+    return m_rows;
+  }
+
+  /** Make sure 'slot' is a valid row, preserving the current traits. */
+  auto reserve(size_t slot) noexcept -> void;
+
+  /** Copy the traits of slot 'from' to slot 'to'. */
+  auto copy(size_t from, size_t to) noexcept -> void;
+
+  /** Traits of slot 'slot'. */
+  auto row(size_t slot) noexcept -> float* {
+    return m_x.data() + slot * m_stride;
+  }
+
+  /** Traits of slot 'slot'. */
+  auto row(size_t slot) const noexcept -> const float* {
+    return m_x.data() + slot * m_stride;
+  }
+
+  /** A view of the traits of slot 'slot'. */
+  auto view(size_t slot) noexcept -> traits_view {
+    return traits_view(row(slot), m_ntraits);
+  }
+
+  /** Apply white noise to the rows of the 'm' slots in 'slots', in this
+    * order, in one pass over the matrix (see wagner::white_noise). */
+  auto white_noise(const size_t *slots, size_t m, std::mt19937_64& rng,
+                   std::normal_distribution<float>& d, float radius = 0.5f,
+                   boundary b = boundary::rejection) noexcept -> void;
+};
+
+/** Euclidean distance between two trait vectors. */
+inline auto euclidean_distance(traits_view xs, traits_view ys) noexcept -> float {
+  return euclidean_distance(xs.data(), ys.data(), min2(xs.size(), ys.size()));
+}
+
+/** Apply white noise to a trait vector, keeping it within the sphere. */
+inline auto white_noise(traits_view xs, std::mt19937_64& rng,
+                        std::normal_distribution<float>& d, float radius = 0.5f,
+                        boundary b = boundary::rejection) noexcept -> void {
+  white_noise(xs.data(), xs.size(), rng, d, radius, b);
+}
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef WAGNER_UNIFORMS_HH_
+#define WAGNER_UNIFORMS_HH_
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace wagner {
+
+/**
+  \brief Uniform draws on [0, 1) taken from an engine in blocks.
+
+  The numbers are drawn a block ahead and converted at once by simd::uniforms:
+  they are the numbers, in the same order, that std::uniform_real_distribution
+  <double> gives when called on the engine. The draws not used are given back
+  (at the latest by the destructor): the engine is then in the state it would
+  be in had it drawn the numbers one by one, so the buffer can replace the
+  distribution without changing any result.
+ */
+class uniform_buffer {
+  std::mt19937_64 &m_rng;
+  std::mt19937_64 m_saved; // The engine before the current block.
+  std::vector<uint64_t> m_raw;
+  std::vector<double> m_draws;
+  size_t m_next; // Next draw of the block.
+  size_t m_size; // Draws in the block.
+  auto m_refill() noexcept -> void;
+
+ public:
+  /** Draw from 'rng' in blocks of 'block' numbers. */
+  explicit uniform_buffer(std::mt19937_64 &rng, size_t block = 256) noexcept;
+
+  uniform_buffer(const uniform_buffer&) = delete;
+  auto operator=(const uniform_buffer&) -> uniform_buffer& = delete;
+
+  /** Give back the draws not used. */
+  ~uniform_buffer() noexcept;
+
+  /** The next draw. */
+  auto operator()() noexcept -> double {
+    if (m_next == m_size) {
+      m_refill();
+    }
+    return m_draws[m_next++];
+  }
+
+  /** Set the engine back to its state after the draws used so far. */
+  auto give_back() noexcept -> void;
+};
+
+}
+
+#endif
@@ -0,0 +1,300 @@
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "wagner/binary.hh"
+
+namespace wagner {
+
+static_assert(sizeof(binary_run_header) % 8 == 0, "Run headers keep the columns aligned.");
+static_assert(sizeof(binary_snapshot_header) % 8 == 0, "Snapshot headers keep the columns aligned.");
+
+static const char run_magic[8] = "WAGNRUN";
+static const char snapshot_magic[8] = "WAGNSPC";
+
+// Round up to a multiple of 8 bytes.
+static auto padded(size_t bytes) noexcept -> size_t {
+  return (bytes + 7) / 8 * 8;
+}
+
+binary_snapshot_layout::binary_snapshot_layout(binary_snapshot_header const& h) noexcept {
+  ids = sizeof(binary_snapshot_header);
+  centroid_x = ids + padded(h.num_species * sizeof(uint64_t));
+  centroid_y = centroid_x + padded(h.num_species * sizeof(double));
+  first_location = centroid_y + padded(h.num_species * sizeof(double));
+  vertices = first_location + padded((h.num_species + 1) * sizeof(uint64_t));
+  groups = vertices + padded(h.num_locations * sizeof(uint32_t));
+  traits = groups + padded(h.num_locations * sizeof(int32_t));
+  size = traits + padded(h.num_species * h.num_traits * sizeof(float));
+}
+
+binary_run_writer::binary_run_writer() noexcept : m_header{} {
+  //
+}
+
+auto binary_run_writer::m_fill_header(run_info const& info, size_t num_vertices) noexcept -> void {
+  m_header = binary_run_header{};
+  std::memcpy(m_header.magic, run_magic, sizeof(run_magic));
+  m_header.byte_order = binary_byte_order;
+  m_header.format_version = binary_format_version;
+  m_header.version = info.version;
+  m_header.revision = info.revision;
+  m_header.model = static_cast<int32_t>(info.m);
+  m_header.sampler = static_cast<int32_t>(info.init);
+  m_header.boundary = static_cast<int32_t>(info.noise_boundary);
+  m_header.schedule = static_cast<int32_t>(info.migration_schedule);
+  m_header.draws = static_cast<int32_t>(info.draws);
+  m_header.seed = info.seed;
+  m_header.t_max = info.t_max;
+  m_header.communities = info.communities;
+  m_header.attempts = info.attempts;
+  m_header.num_traits = info.num_traits;
+  m_header.radius = info.radius;
+  m_header.aleph = info.aleph;
+  m_header.speciation = info.speciation;
+  m_header.migration = info.migration;
+  m_header.extinction = info.extinction;
+  m_header.white_noise_std = info.white_noise_std;
+  m_header.num_vertices = num_vertices;
+}
+
+auto binary_run_writer::open(const char *path, run_info const& info,
+                             std::vector<point> const& positions) noexcept -> void {
+  m_out.open(path, std::ios::binary);
+  m_fill_header(info, positions.size());
+  m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+
+  auto column = std::vector<double>(positions.size());
+  for (size_t v = 0; v < positions.size(); ++v) column[v] = positions[v].x;
+  m_out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(double));
+  for (size_t v = 0; v < positions.size(); ++v) column[v] = positions[v].y;
+  m_out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(double));
+}
+
+auto binary_run_writer::reopen(const char *path, run_info const& info, size_t num_vertices,
+                               size_t size, size_t num_trees) noexcept -> bool {
+  // The header is written again by close().
+  if (!cut_output(path, size)) {
+    return false;
+  }
+  m_out.open(path, std::ios::binary | std::ios::in | std::ios::out);
+  m_out.seekp(size);
+  m_fill_header(info, num_vertices);
+  m_header.num_trees = num_trees;
+  return m_out.good();
+}
+
+auto binary_run_writer::size() noexcept -> size_t {
+  m_out.flush();
+  return static_cast<size_t>(m_out.tellp());
+}
+
+auto binary_run_writer::m_end_tree(std::streampos start) noexcept -> void {
+  auto const end = m_out.tellp();
+  uint64_t const length = static_cast<uint64_t>(end - start) - 2 * sizeof(uint64_t);
+  char const zeros[8] = {0};
+  m_out.write(zeros, padded(length) - length);
+  auto const next = m_out.tellp();
+  m_out.seekp(start + static_cast<std::streamoff>(sizeof(uint64_t)));
+  m_out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+  m_out.seekp(next);
+  ++m_header.num_trees;
+}
+
+auto binary_run_writer::close(const size_t *speciation_per_t, const size_t *extinctions_per_t,
+                              const size_t *species_per_t, size_t n) noexcept -> void {
+  m_header.num_steps = n;
+  m_header.series_offset = static_cast<uint64_t>(m_out.tellp());
+  auto column = std::vector<uint64_t>(n);
+  for (auto series : {speciation_per_t, extinctions_per_t, species_per_t}) {
+    std::copy(series, series + n, column.begin());
+    m_out.write(reinterpret_cast<const char*>(column.data()), n * sizeof(uint64_t));
+  }
+  m_out.seekp(0);
+  m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+  m_out.close();
+}
+
+mapped_file::mapped_file() noexcept : m_data{nullptr}, m_size{0} {
+  //
+}
+
+mapped_file::~mapped_file() noexcept {
+  if (m_data != nullptr) {
+    munmap(const_cast<char*>(m_data), m_size);
+  }
+}
+
+auto mapped_file::open(const char *path) noexcept -> bool {
+  auto const fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  auto const p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    return false;
+  }
+  m_data = static_cast<const char*>(p);
+  m_size = st.st_size;
+  return true;
+}
+
+binary_run_reader::binary_run_reader() noexcept : m_header{nullptr} {
+  //
+}
+
+auto binary_run_reader::open(const char *path) noexcept -> bool {
+  if (!m_file.open(path) || m_file.size() < sizeof(binary_run_header)) {
+    return false;
+  }
+  auto const h = reinterpret_cast<const binary_run_header*>(m_file.data());
+  if (std::memcmp(h->magic, run_magic, sizeof(run_magic)) != 0 ||
+      h->byte_order != binary_byte_order || h->format_version != binary_format_version) {
+    return false;
+  }
+  // The trees are found by walking their records.
+  size_t offset = sizeof(binary_run_header) + 2 * h->num_vertices * sizeof(double);
+  m_trees.clear();
+  for (size_t i = 0; i < h->num_trees; ++i) {
+    if (offset + 2 * sizeof(uint64_t) > m_file.size()) {
+      return false;
+    }
+    m_trees.push_back(offset);
+    auto const length = reinterpret_cast<const uint64_t*>(m_file.data() + offset)[1];
+    offset += 2 * sizeof(uint64_t) + padded(length);
+  }
+  if (offset > h->series_offset ||
+      h->series_offset + 3 * h->num_steps * sizeof(uint64_t) > m_file.size()) {
+    return false;
+  }
+  m_header = h;
+  return true;
+}
+
+auto binary_run_reader::info() const noexcept -> run_info {
+  auto const& h = *m_header;
+  return run_info{static_cast<model>(h.model), h.version, h.revision, h.seed, h.t_max,
+                  h.communities, h.radius, h.attempts, h.num_traits, h.white_noise_std,
+                  static_cast<sampler>(h.sampler), static_cast<boundary>(h.boundary),
+                  static_cast<schedule>(h.schedule), static_cast<migration_draws>(h.draws),
+                  h.aleph, h.speciation, h.migration, h.extinction};
+}
+
+auto binary_run_reader::positions() const noexcept -> std::vector<point> {
+  auto const n = m_header->num_vertices;
+  auto const xs = reinterpret_cast<const double*>(m_file.data() + sizeof(binary_run_header));
+  auto ps = std::vector<point>{};
+  ps.reserve(n);
+  for (size_t v = 0; v < n; ++v) {
+    ps.emplace_back(xs[v], xs[n + v]);
+  }
+  return ps;
+}
+
+auto binary_run_reader::tree_time(size_t i) const noexcept -> size_t {
+  return reinterpret_cast<const uint64_t*>(m_file.data() + m_trees[i])[0];
+}
+
+auto binary_run_reader::tree(size_t i) const noexcept -> std::pair<const char*, size_t> {
+  auto const record = m_file.data() + m_trees[i];
+  auto const length = reinterpret_cast<const uint64_t*>(record)[1];
+  return {record + 2 * sizeof(uint64_t), length};
+}
+
+auto binary_run_reader::speciation_per_t() const noexcept -> const uint64_t* {
+  return reinterpret_cast<const uint64_t*>(m_file.data() + m_header->series_offset);
+}
+
+auto binary_run_reader::extinctions_per_t() const noexcept -> const uint64_t* {
+  return speciation_per_t() + m_header->num_steps;
+}
+
+auto binary_run_reader::species_per_t() const noexcept -> const uint64_t* {
+  return speciation_per_t() + 2 * m_header->num_steps;
+}
+
+auto binary_run_reader::write_xml(std::ostream &os) const noexcept -> void {
+  write_xml_header(os, info());
+  for (size_t i = 0; i < num_trees(); ++i) {
+    auto const newick = tree(i);
+    os << "   <newick><t>" << tree_time(i) << "</t>";
+    os.write(newick.first, newick.second);
+    os << "</newick>\n";
+  }
+  write_xml_footer(os, speciation_per_t(), extinctions_per_t(), species_per_t(), num_steps());
+}
+
+binary_snapshot_reader::binary_snapshot_reader() noexcept : m_header{nullptr} {
+  //
+}
+
+auto binary_snapshot_reader::open(const char *path) noexcept -> bool {
+  if (!m_file.open(path) || m_file.size() < sizeof(binary_snapshot_header)) {
+    return false;
+  }
+  auto const h = reinterpret_cast<const binary_snapshot_header*>(m_file.data());
+  if (std::memcmp(h->magic, snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+      h->byte_order != binary_byte_order || h->format_version != binary_format_version ||
+      binary_snapshot_layout(*h).size > m_file.size()) {
+    return false;
+  }
+  m_header = h;
+  return true;
+}
+
+auto binary_snapshot_reader::ids() const noexcept -> const uint64_t* {
+  return m_column<uint64_t>(binary_snapshot_layout(*m_header).ids);
+}
+
+auto binary_snapshot_reader::centroid_x() const noexcept -> const double* {
+  return m_column<double>(binary_snapshot_layout(*m_header).centroid_x);
+}
+
+auto binary_snapshot_reader::centroid_y() const noexcept -> const double* {
+  return m_column<double>(binary_snapshot_layout(*m_header).centroid_y);
+}
+
+auto binary_snapshot_reader::first_location() const noexcept -> const uint64_t* {
+  return m_column<uint64_t>(binary_snapshot_layout(*m_header).first_location);
+}
+
+auto binary_snapshot_reader::vertices() const noexcept -> const uint32_t* {
+  return m_column<uint32_t>(binary_snapshot_layout(*m_header).vertices);
+}
+
+auto binary_snapshot_reader::groups() const noexcept -> const int32_t* {
+  return m_column<int32_t>(binary_snapshot_layout(*m_header).groups);
+}
+
+auto binary_snapshot_reader::traits() const noexcept -> const float* {
+  return m_column<float>(binary_snapshot_layout(*m_header).traits);
+}
+
+auto binary_snapshot_reader::write_xml(std::ostream &os,
+                                       std::vector<point> const& positions) const noexcept -> void {
+  auto const id = ids();
+  auto const cx = centroid_x();
+  auto const cy = centroid_y();
+  auto const first = first_location();
+  auto const nt = num_traits();
+  os << "<extant_species>\n";
+  os << "  <t>" << t() << "</t>\n";
+  for (size_t s = 0; s < num_species(); ++s) {
+    os << "  ";
+    write_species_xml(os, id[s], point(cx[s], cy[s]), vertices() + first[s],
+                      groups() + first[s], first[s + 1] - first[s], positions.data(),
+                      traits() + s * nt, nt);
+    os << '\n';
+  }
+  os << "</extant_species>\n";
+}
+
+}
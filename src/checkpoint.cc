@@ -0,0 +1,374 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include "wagner/checkpoint.hh"
+#include "wagner/species.hh"
+#include "wagner/tbranch.hh"
+
+namespace wagner {
+
+static_assert(sizeof(checkpoint_header) % 8 == 0, "Checkpoint headers keep the columns aligned.");
+
+static const char checkpoint_magic[8] = "WAGNCKP";
+
+// Round up to a multiple of 8 bytes.
+static auto padded(size_t bytes) noexcept -> size_t {
+  return (bytes + 7) / 8 * 8;
+}
+
+checkpoint_layout::checkpoint_layout(checkpoint_header const& h) noexcept {
+  x = sizeof(checkpoint_header);
+  y = x + padded(h.num_vertices * sizeof(double));
+  offsets = y + padded(h.num_vertices * sizeof(double));
+  adjacency = offsets + padded((h.num_vertices + 1) * sizeof(uint32_t));
+  free_slots = adjacency + padded(h.num_edges * sizeof(uint32_t));
+  end_dates = free_slots + padded(h.num_free_slots * sizeof(uint64_t));
+  leaves = end_dates + padded(h.num_nodes * sizeof(uint64_t));
+  ids = leaves + padded(h.num_nodes * sizeof(uint8_t));
+  slots = ids + padded(h.num_species * sizeof(uint64_t));
+  first_location = slots + padded(h.num_species * sizeof(uint64_t));
+  locations = first_location + padded((h.num_species + 1) * sizeof(uint64_t));
+  traits = locations + padded(h.num_locations * sizeof(uint32_t));
+  speciation_per_t = traits + padded(h.num_species * h.num_traits * sizeof(float));
+  extinctions_per_t = speciation_per_t + padded(h.t * sizeof(uint64_t));
+  species_per_t = extinctions_per_t + padded(h.t * sizeof(uint64_t));
+  engines = species_per_t + padded(h.t * sizeof(uint64_t));
+  size = engines + padded(h.engines_size);
+}
+
+// Write all the bytes to a new file.
+static auto write_file(const char *path, std::vector<char> const& bytes) noexcept -> bool {
+  auto const fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  size_t done = 0;
+  while (done < bytes.size()) {
+    auto const n = ::write(fd, bytes.data() + done, bytes.size() - done);
+    if (n <= 0) {
+      ::close(fd);
+      return false;
+    }
+    done += n;
+  }
+  return ::close(fd) == 0;
+}
+
+auto write_checkpoint(const char *path, run_info const& info,
+                      checkpoint_progress const& progress,
+                      network<point> const& landscape, speciestree const& tree,
+                      const size_t *speciation_per_t, const size_t *extinctions_per_t,
+                      const size_t *species_per_t) noexcept -> bool {
+  // The nodes in preorder, left child first; the leaves are the species.
+  auto nodes = std::vector<const tbranch*>{};
+  auto stack = std::vector<const tbranch*>{};
+  if (tree.root() != nullptr) {
+    stack.push_back(tree.root());
+  }
+  while (!stack.empty()) {
+    auto const node = stack.back();
+    stack.pop_back();
+    nodes.push_back(node);
+    if (!node->leaf()) {
+      stack.push_back(node->right());
+      stack.push_back(node->left());
+    }
+  }
+
+  checkpoint_header h{};
+  std::memcpy(h.magic, checkpoint_magic, sizeof(checkpoint_magic));
+  h.byte_order = binary_byte_order;
+  h.format_version = checkpoint_format_version;
+  h.version = info.version;
+  h.revision = info.revision;
+  h.model = static_cast<int32_t>(info.m);
+  h.sampler = static_cast<int32_t>(info.init);
+  h.boundary = static_cast<int32_t>(info.noise_boundary);
+  h.schedule = static_cast<int32_t>(info.migration_schedule);
+  h.seed = info.seed;
+  h.t_max = info.t_max;
+  h.communities = info.communities;
+  h.attempts = info.attempts;
+  h.num_traits = info.num_traits;
+  h.radius = info.radius;
+  h.aleph = info.aleph;
+  h.speciation = info.speciation;
+  h.migration = info.migration;
+  h.extinction = info.extinction;
+  h.white_noise_std = info.white_noise_std;
+  h.draws = static_cast<int32_t>(info.draws);
+  h.format = static_cast<int32_t>(progress.format);
+  h.migration_threads = static_cast<uint32_t>(progress.migration_threads);
+  h.interval = progress.interval;
+  h.t = progress.t;
+  h.populations = progress.populations;
+  h.info_size = progress.info_size;
+  h.bin_size = progress.bin_size;
+  h.bin_trees = progress.bin_trees;
+  h.start_date = tree.start_date();
+  h.id_count = tree.id_count();
+  h.num_slots = tree.num_slots();
+  h.num_free_slots = tree.free_slots().size();
+  h.num_nodes = nodes.size();
+  h.num_species = 0;
+  for (auto node : nodes) {
+    if (node->leaf()) {
+      ++h.num_species;
+      h.num_locations += static_cast<const species*>(node)->size();
+    }
+  }
+  h.num_vertices = landscape.order();
+  h.num_edges = landscape.size();
+  h.engines_size = progress.engines.size();
+  checkpoint_layout const layout(h);
+
+  // The file is built in memory, padding included, and written at once.
+  auto bytes = std::vector<char>(layout.size, 0);
+  auto column = [&](size_t offset) { return bytes.data() + offset; };
+  std::memcpy(column(0), &h, sizeof(h));
+
+  auto const& positions = landscape.values();
+  for (size_t v = 0; v < positions.size(); ++v) {
+    std::memcpy(column(layout.x) + v * sizeof(double), &positions[v].x, sizeof(double));
+    std::memcpy(column(layout.y) + v * sizeof(double), &positions[v].y, sizeof(double));
+  }
+  std::memcpy(column(layout.offsets), landscape.offsets().data(),
+              landscape.offsets().size() * sizeof(uint32_t));
+  std::memcpy(column(layout.adjacency), landscape.adjacency().data(),
+              landscape.adjacency().size() * sizeof(uint32_t));
+  for (size_t i = 0; i < h.num_free_slots; ++i) {
+    uint64_t const slot = tree.free_slots()[i];
+    std::memcpy(column(layout.free_slots) + i * sizeof(uint64_t), &slot, sizeof(slot));
+  }
+
+  size_t k = 0; // Next species.
+  uint64_t first = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    uint64_t const end_date = nodes[i]->end_date();
+    std::memcpy(column(layout.end_dates) + i * sizeof(uint64_t), &end_date, sizeof(end_date));
+    if (!nodes[i]->leaf()) {
+      continue;
+    }
+    column(layout.leaves)[i] = 1;
+    auto const s = static_cast<const species*>(nodes[i]);
+    uint64_t const id = s->id;
+    uint64_t const slot = s->slot();
+    std::memcpy(column(layout.ids) + k * sizeof(uint64_t), &id, sizeof(id));
+    std::memcpy(column(layout.slots) + k * sizeof(uint64_t), &slot, sizeof(slot));
+    std::memcpy(column(layout.first_location) + k * sizeof(uint64_t), &first, sizeof(first));
+    auto out = reinterpret_cast<uint32_t*>(column(layout.locations)) + first;
+    for (auto v : s->get_locations()) {
+      *out++ = v;
+    }
+    std::copy(s->begin(), s->end(),
+              reinterpret_cast<float*>(column(layout.traits)) + k * h.num_traits);
+    first += s->size();
+    ++k;
+  }
+  std::memcpy(column(layout.first_location) + k * sizeof(uint64_t), &first, sizeof(first));
+
+  std::copy_n(speciation_per_t, h.t, reinterpret_cast<uint64_t*>(column(layout.speciation_per_t)));
+  std::copy_n(extinctions_per_t, h.t, reinterpret_cast<uint64_t*>(column(layout.extinctions_per_t)));
+  std::copy_n(species_per_t, h.t, reinterpret_cast<uint64_t*>(column(layout.species_per_t)));
+  std::memcpy(column(layout.engines), progress.engines.data(), progress.engines.size());
+
+  auto const tmp = std::string(path) + ".tmp";
+  return write_file(tmp.c_str(), bytes) && std::rename(tmp.c_str(), path) == 0;
+}
+
+checkpoint_reader::checkpoint_reader() noexcept
+  : m_header{nullptr}, m_layout(checkpoint_header{}) {
+  //
+}
+
+auto checkpoint_reader::open(const char *path) noexcept -> bool {
+  if (!m_file.open(path) || m_file.size() < sizeof(checkpoint_header)) {
+    return false;
+  }
+  auto const h = reinterpret_cast<const checkpoint_header*>(m_file.data());
+  if (std::memcmp(h->magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0 ||
+      h->byte_order != binary_byte_order || h->format_version != checkpoint_format_version) {
+    return false;
+  }
+  // Every count is bounded by the size of the file, so the layout does not
+  // overflow.
+  auto const size = m_file.size();
+  for (auto count : {h->num_vertices, h->num_edges, h->num_free_slots, h->num_nodes,
+                     h->num_species, h->num_locations, h->num_traits, h->t,
+                     h->engines_size}) {
+    if (count > size) {
+      return false;
+    }
+  }
+  if (h->num_traits > 0 && h->num_species > size / h->num_traits) {
+    return false;
+  }
+  if (checkpoint_layout(*h).size > size) {
+    return false;
+  }
+  m_header = h;
+  m_layout = checkpoint_layout(*h);
+  if (!m_valid()) {
+    m_header = nullptr;
+    return false;
+  }
+  return true;
+}
+
+auto checkpoint_reader::m_valid() const noexcept -> bool {
+  auto const& h = *m_header;
+  if (h.model < 0 || h.model > static_cast<int32_t>(model::fuzzy_traits) ||
+      h.sampler < 0 || h.sampler > static_cast<int32_t>(sampler::direct) ||
+      h.boundary < 0 || h.boundary > static_cast<int32_t>(boundary::project) ||
+      h.schedule < 0 || h.schedule > static_cast<int32_t>(schedule::synchronous) ||
+      h.draws < 0 || h.draws > static_cast<int32_t>(migration_draws::per_target) ||
+      h.format < 0 || h.format > static_cast<int32_t>(output_format::both) ||
+      h.t > h.t_max) {
+    return false;
+  }
+
+  // The landscape: offsets from 0 to num_edges, neighbors among the vertices.
+  auto const n = h.num_vertices;
+  auto const offsets = m_column<uint32_t>(m_layout.offsets);
+  auto const adjacency = m_column<uint32_t>(m_layout.adjacency);
+  if (n > std::numeric_limits<vertex>::max() || offsets[0] != 0 || offsets[n] != h.num_edges) {
+    return false;
+  }
+  for (size_t v = 0; v < n; ++v) {
+    if (offsets[v] > offsets[v + 1]) {
+      return false;
+    }
+  }
+  for (size_t e = 0; e < h.num_edges; ++e) {
+    if (adjacency[e] >= n) {
+      return false;
+    }
+  }
+
+  // The tree: in preorder, every internal node is followed by its two
+  // subtrees, and the leaves are the species.
+  auto const leaves = m_column<uint8_t>(m_layout.leaves);
+  size_t missing = h.num_nodes > 0 ? 1 : 0; // Nodes still expected.
+  size_t num_leaves = 0;
+  for (size_t i = 0; i < h.num_nodes; ++i) {
+    if (missing == 0 || leaves[i] > 1) {
+      return false;
+    }
+    --missing;
+    if (leaves[i]) {
+      ++num_leaves;
+    } else {
+      missing += 2;
+    }
+  }
+  if (missing != 0 || num_leaves != h.num_species) {
+    return false;
+  }
+
+  // The locations of each species, among the vertices.
+  auto const first_location = m_column<uint64_t>(m_layout.first_location);
+  auto const locations = m_column<uint32_t>(m_layout.locations);
+  if (first_location[0] != 0 || first_location[h.num_species] != h.num_locations) {
+    return false;
+  }
+  for (size_t k = 0; k < h.num_species; ++k) {
+    if (first_location[k] > first_location[k + 1]) {
+      return false;
+    }
+  }
+  for (size_t l = 0; l < h.num_locations; ++l) {
+    if (locations[l] >= n) {
+      return false;
+    }
+  }
+
+  // Each slot is held by one species or free, each id was handed out.
+  if (h.num_slots != h.num_species + h.num_free_slots) {
+    return false;
+  }
+  auto taken = std::vector<bool>(h.num_slots, false);
+  auto take = [&taken](uint64_t slot) {
+    if (slot >= taken.size() || taken[slot]) {
+      return false;
+    }
+    taken[slot] = true;
+    return true;
+  };
+  auto const ids = m_column<uint64_t>(m_layout.ids);
+  auto const slots = m_column<uint64_t>(m_layout.slots);
+  auto const free_slots = m_column<uint64_t>(m_layout.free_slots);
+  for (size_t k = 0; k < h.num_species; ++k) {
+    if (ids[k] >= h.id_count || !take(slots[k])) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < h.num_free_slots; ++i) {
+    if (!take(free_slots[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto checkpoint_reader::info() const noexcept -> run_info {
+  auto const& h = *m_header;
+  return run_info{static_cast<model>(h.model), h.version, h.revision, h.seed, h.t_max,
+                  h.communities, h.radius, h.attempts, h.num_traits, h.white_noise_std,
+                  static_cast<sampler>(h.sampler), static_cast<boundary>(h.boundary),
+                  static_cast<schedule>(h.schedule), static_cast<migration_draws>(h.draws),
+                  h.aleph, h.speciation, h.migration, h.extinction};
+}
+
+auto checkpoint_reader::progress() const noexcept -> checkpoint_progress {
+  auto const& h = *m_header;
+  return checkpoint_progress{static_cast<output_format>(h.format), h.migration_threads,
+                             h.interval, h.t, h.populations, h.info_size, h.bin_size,
+                             h.bin_trees,
+                             std::string(m_column<char>(m_layout.engines), h.engines_size)};
+}
+
+auto checkpoint_reader::landscape() const noexcept -> network<point> {
+  auto const n = m_header->num_vertices;
+  auto const xs = m_column<double>(m_layout.x);
+  auto const ys = m_column<double>(m_layout.y);
+  auto ps = std::vector<point>{};
+  ps.reserve(n);
+  for (size_t v = 0; v < n; ++v) {
+    ps.emplace_back(xs[v], ys[v]);
+  }
+  auto const offsets = m_column<uint32_t>(m_layout.offsets);
+  auto const adjacency = m_column<vertex>(m_layout.adjacency);
+  return network<point>(std::move(ps), std::vector<uint32_t>(offsets, offsets + n + 1),
+                        std::vector<vertex>(adjacency, adjacency + m_header->num_edges));
+}
+
+auto checkpoint_reader::tree() const noexcept -> tree_columns {
+  auto const& h = *m_header;
+  return tree_columns{h.start_date, h.id_count, h.num_slots,
+                      h.num_free_slots, m_column<uint64_t>(m_layout.free_slots),
+                      h.num_nodes, m_column<uint64_t>(m_layout.end_dates),
+                      m_column<uint8_t>(m_layout.leaves),
+                      h.num_species, m_column<uint64_t>(m_layout.ids),
+                      m_column<uint64_t>(m_layout.slots),
+                      m_column<uint64_t>(m_layout.first_location),
+                      m_column<uint32_t>(m_layout.locations),
+                      h.num_traits, m_column<float>(m_layout.traits)};
+}
+
+auto checkpoint_reader::speciation_per_t() const noexcept -> const uint64_t* {
+  return m_column<uint64_t>(m_layout.speciation_per_t);
+}
+
+auto checkpoint_reader::extinctions_per_t() const noexcept -> const uint64_t* {
+  return m_column<uint64_t>(m_layout.extinctions_per_t);
+}
+
+auto checkpoint_reader::species_per_t() const noexcept -> const uint64_t* {
+  return m_column<uint64_t>(m_layout.species_per_t);
+}
+
+}
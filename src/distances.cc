@@ -0,0 +1,42 @@
+#include <vector>
+#include <algorithm>
+#include "wagner/common.hh"
+#include "wagner/distances.hh"
+
+namespace wagner {
+
+distance_matrix::distance_matrix() noexcept : m_cap{0} {
+  //
+}
+
+auto distance_matrix::capacity() const noexcept -> size_t {
+  return m_cap;
+}
+
+auto distance_matrix::reserve(size_t slot) noexcept -> void {
+  if (slot < m_cap) {
+    return;
+  }
+  size_t cap = max2(m_cap * 2, (size_t)16);
+  while (cap <= slot) {
+    cap *= 2;
+  }
+  std::vector<float> d(cap * cap, 0.0f);
+  for (size_t i = 0; i < m_cap; ++i) {
+    std::copy_n(m_d.begin() + i * m_cap, m_cap, d.begin() + i * cap);
+  }
+  m_d.swap(d);
+  m_cap = cap;
+}
+
+auto distance_matrix::copy(size_t from, size_t to) noexcept -> void {
+  reserve(max2(from, to));
+  std::copy_n(m_d.begin() + from * m_cap, m_cap, m_d.begin() + to * m_cap);
+  for (size_t i = 0; i < m_cap; ++i) {
+    m_d[i * m_cap + to] = m_d[i * m_cap + from];
+  }
+  set(from, to, 0.0f);
+  m_d[to * m_cap + to] = 0.0f;
+}
+
+}
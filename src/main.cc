@@ -3,11 +3,18 @@
 #include <random>
 #include <vector>
 #include <cstring>
+#include <algorithm>
 #include "wagner/simulation.hh"
 #include "wagner/model.hh"
+#include "wagner/thread_pool.hh"
 
 int main(int argc, char *argv[]) {
   size_t nthreads = std::thread::hardware_concurrency(); // number of threads
+  size_t runs = 0; // number of simulations, one per thread if 0
+  size_t migration_threads = 0; // threads for the migration phase of each run
+  wagner::migration_draws draws = wagner::migration_draws::per_trial;
+  size_t checkpoint_interval = 0; // time steps between checkpoints, none if 0
+  const char *resume = nullptr; // checkpoint to resume from
   wagner::model m = wagner::model::euclidean_traits;
   size_t seed = std::random_device{}();
   size_t t_max = (1 << 9);
@@ -19,6 +26,9 @@ int main(int argc, char *argv[]) {
   double speciation = 0.04;
   double radius = 0.20;
   float white_noise_std = 0.005f;
+  wagner::sampler init = wagner::sampler::rejection;
+  wagner::boundary noise_boundary = wagner::boundary::rejection;
+  wagner::output_format format = wagner::output_format::xml;
 
   for (int i = 1; i < argc; ++i) {
     if (std::strcmp(argv[i], "-model") == 0) {
@@ -40,12 +50,37 @@ int main(int argc, char *argv[]) {
     }
     else if (std::strcmp(argv[i], "-threads") == 0)
       nthreads = atoi(argv[i + 1]);
+    else if (std::strcmp(argv[i], "-runs") == 0)
+      runs = atoi(argv[i + 1]);
+    else if (std::strcmp(argv[i], "-mt") == 0)
+      migration_threads = atoi(argv[i + 1]);
+    else if (std::strcmp(argv[i], "-draws") == 0)
+      draws = atoi(argv[i + 1]) == 1 ? wagner::migration_draws::per_target
+                                     : wagner::migration_draws::per_trial;
+    else if (std::strcmp(argv[i], "-checkpoint") == 0)
+      checkpoint_interval = atoi(argv[i + 1]);
+    else if (std::strcmp(argv[i], "-resume") == 0)
+      resume = argv[i + 1];
     else if (std::strcmp(argv[i], "-seed") == 0)
       seed = atoi(argv[i + 1]);
     else if (std::strcmp(argv[i], "-n") == 0)
       traits = atoi(argv[i + 1]);
     else if (std::strcmp(argv[i], "-w") == 0)
       white_noise_std = atof(argv[i + 1]);
+    else if (std::strcmp(argv[i], "-sampler") == 0)
+      init = atoi(argv[i + 1]) == 1 ? wagner::sampler::direct : wagner::sampler::rejection;
+    else if (std::strcmp(argv[i], "-boundary") == 0) {
+      const int boundary_id = atoi(argv[i + 1]);
+      noise_boundary = boundary_id == 1 ? wagner::boundary::reflect
+                     : boundary_id == 2 ? wagner::boundary::project
+                     : wagner::boundary::rejection;
+    }
+    else if (std::strcmp(argv[i], "-output") == 0) {
+      const int format_id = atoi(argv[i + 1]);
+      format = format_id == 1 ? wagner::output_format::binary
+             : format_id == 2 ? wagner::output_format::both
+             : wagner::output_format::xml;
+    }
     else if (std::strcmp(argv[i], "-c") == 0)
       communities = atoi(argv[i + 1]);
     else if (std::strcmp(argv[i], "-t") == 0)
@@ -62,6 +97,15 @@ int main(int argc, char *argv[]) {
       radius = std::atof(argv[i + 1]);
   }
 
+  // The run goes on with its own parameters:
+  if (resume != nullptr) {
+    if (!wagner::resume(resume, migration_threads, checkpoint_interval)) {
+      std::cout << "Cannot read the checkpoint " << resume << ".\n";
+      return 1;
+    }
+    return 0;
+  }
+
   // Force 't_max' to be a power of two:
   if (!power_of_two(t_max)) {
     size_t new_t = 1;
@@ -71,22 +115,29 @@ int main(int argc, char *argv[]) {
     t_max = (new_t >> 1);
   }
 
-  // Seed the various threads
+  if (nthreads == 0) {
+    nthreads = 1;
+  }
+  if (runs == 0) {
+    runs = nthreads;
+  }
+
+  // Seed the various runs
   std::mt19937_64 rng(seed); // The engine
   std::uniform_int_distribution<size_t> uni;
 
-  std::vector<std::thread> threads;
-
-  // Rather naive but hey, it works fine:
-  for (auto i = 0u; i < nthreads; ++i) {
-    threads.push_back(
-      std::thread(
-        wagner::simulation, m, uni(rng), t_max, communities, traits, ext_max,
-        mig_max, aleph, speciation, radius, white_noise_std));
+  // The workers take the runs in order, each one as soon as it is free:
+  wagner::thread_pool workers(std::min(nthreads, runs));
+  for (auto i = 0u; i < runs; ++i) {
+    auto const run_seed = uni(rng);
+    workers.submit([=] {
+      wagner::simulation(m, run_seed, t_max, communities, traits, ext_max,
+                         mig_max, aleph, speciation, radius, white_noise_std, init,
+                         noise_boundary, format, migration_threads, draws,
+                         checkpoint_interval);
+    });
   }
-
-  for (auto& thread : threads)
-    thread.join();
+  workers.wait();
 
   return 0;
 }
@@ -0,0 +1,230 @@
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <cmath>
+#include <cassert>
+#include "wagner/common.hh"
+#include "wagner/migration.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/species.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/model.hh"
+#include "wagner/philox.hh"
+#include "wagner/uniforms.hh"
+
+namespace wagner {
+
+// Migration rate of species 's0' to 'location' (not occupied by 's0').
+template<model m>
+static inline auto rate(speciestree &tree, const species *s0, vertex location,
+                        size_t t, double mig_max, double aleph) noexcept -> double {
+  double mig = mig_max;
+
+  if (m == model::euclidean_traits) {
+    double delta = 0.0;
+    for (auto s1 : tree.residents(location)) {
+      const auto dist = tree.distance(*s0, *s1);
+      assert(dist >= 0.0f && dist <= 1.0f);
+      delta += 1.0 - dist;
+    }
+    mig *= exp(-aleph * delta);
+  } else if (m == model::phylo_dist) {
+    // Only the first resident counts.
+    auto const& residents = tree.residents(location);
+    if (!residents.empty()) {
+      double const delta = 1.0 / (t - tree.mrca(*s0, **residents.begin()));
+      mig *= exp(-aleph * delta);
+    }
+  } else if (m == model::fuzzy_traits) {
+    double delta = 0.0;
+    for (auto s1 : tree.residents(location)) {
+      const auto prox = 1.0 - tree.distance(*s0, *s1);
+      assert(prox >= 0.0f && prox <= 1.0f);
+      if (prox > delta)
+        delta = prox;
+    }
+    mig *= 1.0 - delta;
+  }
+  return mig;
+}
+
+// Turn of species 's0' with one draw per target: the empty neighbors of its
+// populations, in the order they are first reached. The rate to a target does
+// not change during the turn, so its k trials succeed at least once with
+// probability 1 - (1 - rate)^k. 'found' is called on the new populations.
+template<model m, typename Draw, typename Found>
+static auto leap(speciestree &tree, network<point> const& landscape,
+                 const species *s0, size_t t, double mig_max, double aleph,
+                 Draw &&draw, Found &&found) noexcept -> void {
+  thread_local std::vector<uint32_t> index; // Position + 1 of each target, or 0.
+  thread_local std::vector<std::pair<vertex, uint32_t>> targets; // And their trials.
+  constexpr auto present = ~uint32_t(0); // Index of the populations of 's0'.
+  if (index.size() < landscape.order()) {
+    index.resize(landscape.order(), 0);
+  }
+  for (auto v : s0->get_locations()) {
+    index[v] = present;
+  }
+  targets.clear();
+  for (auto source : s0->get_locations()) {
+    for (auto location : landscape.neighbors(source)) {
+      auto &i = index[location];
+      if (i == present) {
+        continue;
+      }
+      if (i == 0) {
+        targets.emplace_back(location, 0);
+        i = targets.size();
+      }
+      ++targets[i - 1].second;
+    }
+  }
+  for (auto v : s0->get_locations()) {
+    index[v] = 0;
+  }
+  for (auto const& target : targets) {
+    index[target.first] = 0;
+  }
+
+  for (auto const& target : targets) {
+    auto const r = rate<m>(tree, s0, target.first, t, mig_max, aleph);
+    if (draw() < -std::expm1(target.second * std::log1p(-r))) {
+      found(target.first);
+    }
+  }
+}
+
+template<model m>
+auto migration(speciestree &tree, network<point> const& landscape,
+               size_t t, double mig_max, double aleph,
+               std::mt19937_64 &rng, migration_draws draws) noexcept -> size_t {
+  uniform_buffer unif(rng); // Gives back the draws not used when the phase ends.
+  std::vector<vertex> sources; // Populations at the start of the species' turn.
+  size_t new_pops = 0;
+
+  for (auto s0 : tree) {
+    if (draws == migration_draws::per_target) {
+      leap<m>(tree, landscape, s0, t, mig_max, aleph, unif, [&](vertex location) {
+        s0->add_to(location);
+        ++new_pops;
+      });
+      continue;
+    }
+    auto const& presences = s0->get_locations();
+    sources.assign(presences.begin(), presences.end());
+    for (auto const& source : sources) {
+      for (auto location : landscape.neighbors(source)) {
+        if (s0->is_in(location)) {
+          continue;
+        }
+        if (unif() < rate<m>(tree, s0, location, t, mig_max, aleph)) {
+          s0->add_to(location);
+          ++new_pops;
+        }
+      }
+    }
+  }
+  return new_pops;
+}
+
+// Key of the philox streams of the migration phase (second word).
+constexpr uint64_t migration_phase = 1;
+
+// New populations of species 's0', which is not changed: a location is
+// founded at most once, as if the species was added to it.
+template<model m>
+static auto founded(speciestree &tree, network<point> const& landscape,
+                    const species *s0, size_t t, double mig_max, double aleph,
+                    uint64_t seed, migration_draws draws, std::vector<vertex> &out) noexcept -> void {
+  thread_local std::vector<uint64_t> stamps; // Last turn that founded each location.
+  thread_local uint64_t turn = 0;
+  if (stamps.size() < landscape.order()) {
+    stamps.resize(landscape.order(), 0);
+  }
+  ++turn;
+
+  philox rng(seed, migration_phase, t, s0->id);
+  std::uniform_real_distribution<> unif;
+  out.clear();
+  if (draws == migration_draws::per_target) {
+    leap<m>(tree, landscape, s0, t, mig_max, aleph, [&] { return unif(rng); },
+            [&](vertex location) { out.push_back(location); });
+    return;
+  }
+  for (auto source : s0->get_locations()) {
+    for (auto location : landscape.neighbors(source)) {
+      if (s0->is_in(location) || stamps[location] == turn) {
+        continue;
+      }
+      if (unif(rng) < rate<m>(tree, s0, location, t, mig_max, aleph)) {
+        stamps[location] = turn;
+        out.push_back(location);
+      }
+    }
+  }
+}
+
+synchronous_migration::synchronous_migration(size_t threads, uint64_t seed) noexcept
+  : m_workers(threads), m_seed{seed} {
+  //
+}
+
+template<model m>
+auto synchronous_migration::run(speciestree &tree, network<point> const& landscape,
+                                size_t t, double mig_max, double aleph,
+                                migration_draws draws) noexcept -> size_t {
+  m_species.assign(tree.begin(), tree.end());
+  if (m_founded.size() < m_species.size()) {
+    m_founded.resize(m_species.size());
+  }
+  if (m == model::phylo_dist && !m_species.empty()) {
+    // Builds the index now, the workers only read it.
+    tree.mrca(*m_species[0], *m_species[0]);
+  }
+  // A few chunks per worker, taken by the first free worker.
+  auto const n = m_species.size();
+  auto const chunks = std::min(n, 4 * m_workers.size());
+  for (size_t c = 0; c < chunks; ++c) {
+    auto const first = c * n / chunks;
+    auto const last = (c + 1) * n / chunks;
+    m_workers.submit([=, &tree, &landscape] {
+      for (auto r = first; r < last; ++r) {
+        founded<m>(tree, landscape, m_species[r], t, mig_max, aleph, m_seed, draws, m_founded[r]);
+      }
+    });
+  }
+  m_workers.wait();
+
+  size_t new_pops = 0;
+  for (size_t r = 0; r < n; ++r) {
+    for (auto location : m_founded[r]) {
+      m_species[r]->add_to(location);
+    }
+    new_pops += m_founded[r].size();
+  }
+  return new_pops;
+}
+
+template auto migration<model::neutral>(speciestree&, network<point> const&,
+    size_t, double, double, std::mt19937_64&, migration_draws) noexcept -> size_t;
+template auto migration<model::phylo_dist>(speciestree&, network<point> const&,
+    size_t, double, double, std::mt19937_64&, migration_draws) noexcept -> size_t;
+template auto migration<model::euclidean_traits>(speciestree&, network<point> const&,
+    size_t, double, double, std::mt19937_64&, migration_draws) noexcept -> size_t;
+template auto migration<model::fuzzy_traits>(speciestree&, network<point> const&,
+    size_t, double, double, std::mt19937_64&, migration_draws) noexcept -> size_t;
+
+template auto synchronous_migration::run<model::neutral>(speciestree&, network<point> const&,
+    size_t, double, double, migration_draws) noexcept -> size_t;
+template auto synchronous_migration::run<model::phylo_dist>(speciestree&, network<point> const&,
+    size_t, double, double, migration_draws) noexcept -> size_t;
+template auto synchronous_migration::run<model::euclidean_traits>(speciestree&, network<point> const&,
+    size_t, double, double, migration_draws) noexcept -> size_t;
+template auto synchronous_migration::run<model::fuzzy_traits>(speciestree&, network<point> const&,
+    size_t, double, double, migration_draws) noexcept -> size_t;
+
+}
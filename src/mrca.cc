@@ -0,0 +1,75 @@
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "wagner/common.hh"
+#include "wagner/tbranch.hh"
+#include "wagner/mrca.hh"
+
+namespace wagner {
+
+// Index of the most significant bit.
+static inline auto floor_log2(uint32_t x) noexcept -> uint32_t {
+  return 31 - __builtin_clz(x);
+}
+
+mrca_index::mrca_index() noexcept {
+  //
+}
+
+auto mrca_index::build(tbranch *root) noexcept -> void {
+  m_tour.clear();
+  m_depth.clear();
+  if (root == nullptr) {
+    m_sparse.clear();
+    return;
+  }
+
+  // Explicit stack of (node, number of children visited).
+  std::vector<std::pair<tbranch*, int>> stack;
+  stack.emplace_back(root, 0);
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    tbranch *node = top.first;
+    if (top.second == 0) {
+      node->set_euler(m_tour.size());
+    }
+    m_tour.push_back(node);
+    m_depth.push_back(stack.size() - 1);
+    if (node->leaf() || top.second == 2) {
+      stack.pop_back();
+    } else {
+      tbranch *child = (top.second++ == 0) ? node->left() : node->right();
+      stack.emplace_back(child, 0);
+    }
+  }
+
+  auto const n = (uint32_t)m_tour.size();
+  auto const levels = floor_log2(n) + 1;
+  m_sparse.resize(levels);
+  m_sparse[0].resize(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    m_sparse[0][i] = i;
+  }
+  for (uint32_t k = 1; k < levels; ++k) {
+    auto const half = 1u << (k - 1);
+    auto const &prev = m_sparse[k - 1];
+    auto &row = m_sparse[k];
+    row.resize(n - (1u << k) + 1);
+    for (uint32_t i = 0; i < row.size(); ++i) {
+      auto const a = prev[i], b = prev[i + half];
+      row[i] = m_depth[a] <= m_depth[b] ? a : b;
+    }
+  }
+}
+
+auto mrca_index::operator()(const tbranch *t0, const tbranch *t1) const noexcept -> const tbranch* {
+  auto i = (uint32_t)t0->euler(), j = (uint32_t)t1->euler();
+  if (i > j) {
+    std::swap(i, j);
+  }
+  auto const k = floor_log2(j - i + 1);
+  auto const a = m_sparse[k][i], b = m_sparse[k][j - (1u << k) + 1];
+  return m_tour[m_depth[a] <= m_depth[b] ? a : b];
+}
+
+}
@@ -0,0 +1,34 @@
+#include "wagner/common.hh"
+#include "wagner/occupancy.hh"
+#include "wagner/network.hh"
+
+namespace wagner {
+
+const species_set occupancy::m_nobody;
+
+occupancy::occupancy() noexcept {
+  //
+}
+
+auto occupancy::add(vertex v, species *s) noexcept -> void {
+  if (v >= m_residents.size()) {
+    m_residents.resize(v + 1);
+  }
+  m_residents[v].insert(s);
+}
+
+auto occupancy::rmv(vertex v, species *s) noexcept -> void {
+  if (v < m_residents.size()) {
+    m_residents[v].erase(s);
+  }
+}
+
+auto occupancy::residents(vertex v) const noexcept -> species_set const& {
+  return v < m_residents.size() ? m_residents[v] : m_nobody;
+}
+
+auto occupancy::size(vertex v) const noexcept -> size_t {
+  return residents(v).size();
+}
+
+}
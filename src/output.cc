@@ -0,0 +1,61 @@
+#include <ostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "wagner/output.hh"
+
+namespace wagner {
+
+auto cut_output(const char *path, size_t size) noexcept -> bool {
+  struct stat st;
+  if (::stat(path, &st) != 0 || static_cast<size_t>(st.st_size) < size) {
+    return false;
+  }
+  return ::truncate(path, size) == 0;
+}
+
+auto write_xml_header(std::ostream &os, run_info const& info) noexcept -> void {
+  bool const has_traits = info.m == model::euclidean_traits || info.m == model::fuzzy_traits;
+  os << "<wagner>\n";
+  os << "   <version>" << info.version << "</version>\n";
+  os << "   <revision>" << info.revision << "</revision>\n";
+  os << "   <model>" << info.m << "</model>\n";
+  os << "   <master_seed>" << info.seed << "</master_seed>\n";
+  os << "   <t_max>" << info.t_max << "</t_max>\n";
+  os << "   <communities>" << info.communities << "</communities>\n";
+  os << "   <radius>" << info.radius << "</radius>\n";
+  os << "   <attempts>" << info.attempts << "</attempts>\n";
+  if (has_traits) {
+    os << "   <num_traits>" << info.num_traits << "</num_traits>\n";
+    os << "   <white_noise_std>" << info.white_noise_std << "</white_noise_std>\n";
+    os << "   <sampler>" << info.init << "</sampler>\n";
+    os << "   <boundary>" << info.noise_boundary << "</boundary>\n";
+  }
+  if (info.m != model::neutral) {
+    os << "   <aleph>" << info.aleph << "</aleph>\n";
+  }
+  os << "   <speciation>" << info.speciation << "</speciation>\n";
+  os << "   <migration>" << info.migration << "</migration>\n";
+  os << "   <schedule>" << info.migration_schedule << "</schedule>\n";
+  os << "   <draws>" << info.draws << "</draws>\n";
+  os << "   <extinction>" << info.extinction << "</extinction>\n";
+}
+
+auto write_species_xml(std::ostream &os, size_t id, point const& centroid,
+                       const vertex *locations, const int *groups, size_t n,
+                       const point *positions, const float *traits,
+                       size_t num_traits) noexcept -> void {
+  os << "<species> <id>" << id << "</id> <centroid>"
+     << centroid << "</centroid> <locations>";
+  for (size_t i = 0; i < n; ++i) {
+    os << " <vertex><id>" << locations[i] << "</id><position>" << positions[locations[i]]
+       << "</position><group>" << groups[i] << "</group></vertex>";
+  }
+  os << "</locations> <traits>[";
+  if (num_traits) {
+    os << traits[0];
+    for (size_t i = 1; i < num_traits; ++i) os << ", " << traits[i];
+  }
+  os << "]</traits></species>";
+}
+
+}
@@ -0,0 +1,284 @@
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include "wagner/simd.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define WAGNER_X86 1
+  #include <immintrin.h>
+#endif
+
+namespace wagner {
+namespace simd {
+
+// All kernels compute the same thing: lane k (k < 16) sums the squares of
+// the elements i = k mod 16, block after block, the last block being padded
+// with zeros. The lanes are then added pairwise: k + 8, k + 4, k + 2, k + 1.
+
+template<bool Diff>
+static auto squares_scalar(const float *xs, const float *ys, size_t n) noexcept -> float {
+  float lanes[16] = {0.0f};
+  for (size_t i = 0; i < n; ++i) {
+    float const d = Diff ? xs[i] - ys[i] : xs[i];
+    lanes[i % 16] += d * d;
+  }
+  for (size_t w = 8; w > 0; w /= 2) {
+    for (size_t k = 0; k < w; ++k) {
+      lanes[k] += lanes[k + w];
+    }
+  }
+  return lanes[0];
+}
+
+#ifdef WAGNER_X86
+// Last two steps of the sum: lanes k + 2, then k + 1.
+__attribute__((target("sse2")))
+static inline auto sum4(__m128 s) noexcept -> float {
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx")))
+static inline auto sum8(__m256 s) noexcept -> float {
+  return sum4(_mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1)));
+}
+
+template<bool Diff>
+__attribute__((target("sse2")))
+static auto squares_sse2(const float *xs, const float *ys, size_t n) noexcept -> float {
+  __m128 acc[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+  auto block = [&](const float *x, const float *y) {
+    for (int j = 0; j < 4; ++j) {
+      __m128 d = _mm_loadu_ps(x + 4 * j);
+      if (Diff) d = _mm_sub_ps(d, _mm_loadu_ps(y + 4 * j));
+      acc[j] = _mm_add_ps(acc[j], _mm_mul_ps(d, d));
+    }
+  };
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    block(xs + i, Diff ? ys + i : nullptr);
+  }
+  if (i < n) {
+    float x[16] = {0.0f}, y[16] = {0.0f};
+    std::memcpy(x, xs + i, (n - i) * sizeof(float));
+    if (Diff) std::memcpy(y, ys + i, (n - i) * sizeof(float));
+    block(x, y);
+  }
+  return sum4(_mm_add_ps(_mm_add_ps(acc[0], acc[2]), _mm_add_ps(acc[1], acc[3])));
+}
+
+template<bool Diff>
+__attribute__((target("avx2")))
+static auto squares_avx2(const float *xs, const float *ys, size_t n) noexcept -> float {
+  __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256 d0 = _mm256_loadu_ps(xs + i), d1 = _mm256_loadu_ps(xs + i + 8);
+    if (Diff) {
+      d0 = _mm256_sub_ps(d0, _mm256_loadu_ps(ys + i));
+      d1 = _mm256_sub_ps(d1, _mm256_loadu_ps(ys + i + 8));
+    }
+    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(d0, d0));
+    acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(d1, d1));
+  }
+  if (i < n) {
+    auto const r = static_cast<int>(n - i);
+    auto const idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    auto const m0 = _mm256_cmpgt_epi32(_mm256_set1_epi32(r), idx);
+    auto const m1 = _mm256_cmpgt_epi32(_mm256_set1_epi32(r - 8), idx);
+    __m256 d0 = _mm256_maskload_ps(xs + i, m0), d1 = _mm256_maskload_ps(xs + i + 8, m1);
+    if (Diff) {
+      d0 = _mm256_sub_ps(d0, _mm256_maskload_ps(ys + i, m0));
+      d1 = _mm256_sub_ps(d1, _mm256_maskload_ps(ys + i + 8, m1));
+    }
+    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(d0, d0));
+    acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(d1, d1));
+  }
+  return sum8(_mm256_add_ps(acc0, acc1));
+}
+
+template<bool Diff>
+__attribute__((target("avx512f")))
+static auto squares_avx512(const float *xs, const float *ys, size_t n) noexcept -> float {
+  __m512 acc = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 d = _mm512_loadu_ps(xs + i);
+    if (Diff) d = _mm512_sub_ps(d, _mm512_loadu_ps(ys + i));
+    acc = _mm512_add_ps(acc, _mm512_mul_ps(d, d));
+  }
+  if (i < n) {
+    auto const m = static_cast<__mmask16>((1u << (n - i)) - 1);
+    __m512 d = _mm512_maskz_loadu_ps(m, xs + i);
+    if (Diff) d = _mm512_sub_ps(d, _mm512_maskz_loadu_ps(m, ys + i));
+    acc = _mm512_add_ps(acc, _mm512_mul_ps(d, d));
+  }
+  acc = _mm512_add_ps(acc, _mm512_maskz_shuffle_f32x4(0xFFFF, acc, acc, _MM_SHUFFLE(3, 2, 3, 2)));
+  acc = _mm512_add_ps(acc, _mm512_maskz_shuffle_f32x4(0xFFFF, acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+  return sum4(_mm512_mask_extractf32x4_ps(_mm_setzero_ps(), 0xF, acc, 0));
+}
+#endif
+
+// Uniform draws: x * 2^-64 with x rounded to the nearest double, below 1.
+// The vector kernels round x through its two halves, both exact doubles:
+// (2^84 + hi * 2^32 - (2^84 + 2^52)) + (2^52 + lo) rounds only once.
+static constexpr double two_52 = 4503599627370496.0;
+static constexpr double two_84 = 19342813113834066795298816.0;
+static constexpr double two_minus_64 = 1.0 / 18446744073709551616.0;
+static constexpr double below_one = 1.0 - 1.0 / 9007199254740992.0; // 1 - 2^-53
+
+static auto uniforms_scalar(const uint64_t *xs, size_t n, double *out) noexcept -> void {
+  for (size_t i = 0; i < n; ++i) {
+    double const u = static_cast<double>(xs[i]) * two_minus_64;
+    out[i] = u < 1.0 ? u : below_one;
+  }
+}
+
+#ifdef WAGNER_X86
+__attribute__((target("sse2")))
+static auto uniforms_sse2(const uint64_t *xs, size_t n, double *out) noexcept -> void {
+  auto const low = _mm_set1_epi64x(0xFFFFFFFFll);
+  auto const lo_bias = _mm_set1_epi64x(0x4330000000000000ll);
+  auto const hi_bias = _mm_set1_epi64x(0x4530000000000000ll);
+  auto const both = _mm_set1_pd(two_84 + two_52);
+  auto const scale = _mm_set1_pd(two_minus_64);
+  auto const top = _mm_set1_pd(below_one);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    auto const x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i));
+    auto const lo = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(x, low), lo_bias));
+    auto const hi = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(x, 32), hi_bias));
+    auto const u = _mm_mul_pd(_mm_add_pd(_mm_sub_pd(hi, both), lo), scale);
+    _mm_storeu_pd(out + i, _mm_min_pd(u, top));
+  }
+  uniforms_scalar(xs + i, n - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static auto uniforms_avx2(const uint64_t *xs, size_t n, double *out) noexcept -> void {
+  auto const low = _mm256_set1_epi64x(0xFFFFFFFFll);
+  auto const lo_bias = _mm256_set1_epi64x(0x4330000000000000ll);
+  auto const hi_bias = _mm256_set1_epi64x(0x4530000000000000ll);
+  auto const both = _mm256_set1_pd(two_84 + two_52);
+  auto const scale = _mm256_set1_pd(two_minus_64);
+  auto const top = _mm256_set1_pd(below_one);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto const x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i));
+    auto const lo = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(x, low), lo_bias));
+    auto const hi = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(x, 32), hi_bias));
+    auto const u = _mm256_mul_pd(_mm256_add_pd(_mm256_sub_pd(hi, both), lo), scale);
+    _mm256_storeu_pd(out + i, _mm256_min_pd(u, top));
+  }
+  uniforms_scalar(xs + i, n - i, out + i);
+}
+
+// GCC 12 takes the self-initialized _mm512_undefined_* operands of its shift
+// and min intrinsics for uninitialized values.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+__attribute__((target("avx512f")))
+static auto uniforms_avx512(const uint64_t *xs, size_t n, double *out) noexcept -> void {
+  auto const low = _mm512_set1_epi64(0xFFFFFFFFll);
+  auto const lo_bias = _mm512_set1_epi64(0x4330000000000000ll);
+  auto const hi_bias = _mm512_set1_epi64(0x4530000000000000ll);
+  auto const both = _mm512_set1_pd(two_84 + two_52);
+  auto const scale = _mm512_set1_pd(two_minus_64);
+  auto const top = _mm512_set1_pd(below_one);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    auto const x = _mm512_loadu_si512(xs + i);
+    auto const lo = _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(x, low), lo_bias));
+    auto const hi = _mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(x, 32), hi_bias));
+    auto const u = _mm512_mul_pd(_mm512_add_pd(_mm512_sub_pd(hi, both), lo), scale);
+    _mm512_storeu_pd(out + i, _mm512_min_pd(u, top));
+  }
+  uniforms_scalar(xs + i, n - i, out + i);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+// Instantiates the entry points of an instruction set, so the kernels are
+// inlined in the batched loop.
+#define WAGNER_SIMD_ENTRIES(isa, target)                                                       \
+  target static auto distance_##isa(const float *xs, const float *ys, size_t n) noexcept      \
+      -> float {                                                                               \
+    return squares_##isa<true>(xs, ys, n);                                                     \
+  }                                                                                            \
+  target static auto norm_##isa(const float *xs, size_t n) noexcept -> float {                 \
+    return squares_##isa<false>(xs, nullptr, n);                                               \
+  }                                                                                            \
+  target static auto distances_##isa(const float *x, const float *base, size_t stride,        \
+                                     const size_t *rows, size_t m, size_t n, float *out)      \
+                                     noexcept -> void {                                        \
+    for (size_t k = 0; k < m; ++k) {                                                           \
+      out[k] = std::sqrt(squares_##isa<true>(x, base + rows[k] * stride, n));                  \
+    }                                                                                          \
+  }
+
+WAGNER_SIMD_ENTRIES(scalar, )
+#ifdef WAGNER_X86
+WAGNER_SIMD_ENTRIES(sse2, __attribute__((target("sse2"))))
+WAGNER_SIMD_ENTRIES(avx2, __attribute__((target("avx2"))))
+WAGNER_SIMD_ENTRIES(avx512, __attribute__((target("avx512f"))))
+#endif
+
+#undef WAGNER_SIMD_ENTRIES
+
+struct implementation {
+  const char *name;
+  decltype(&distance_scalar) distance;
+  decltype(&norm_scalar) norm;
+  decltype(&distances_scalar) distances;
+  decltype(&uniforms_scalar) uniforms;
+};
+
+static auto choose() noexcept -> implementation {
+#ifdef WAGNER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return {"avx512", distance_avx512, norm_avx512, distances_avx512, uniforms_avx512};
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return {"avx2", distance_avx2, norm_avx2, distances_avx2, uniforms_avx2};
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return {"sse2", distance_sse2, norm_sse2, distances_sse2, uniforms_sse2};
+  }
+#endif
+  return {"scalar", distance_scalar, norm_scalar, distances_scalar, uniforms_scalar};
+}
+
+static auto chosen() noexcept -> implementation const& {
+  static const implementation impl = choose();
+  return impl;
+}
+
+auto isa() noexcept -> const char* {
+  return chosen().name;
+}
+
+auto squared_distance(const float *xs, const float *ys, size_t n) noexcept -> float {
+  return chosen().distance(xs, ys, n);
+}
+
+auto squared_norm(const float *xs, size_t n) noexcept -> float {
+  return chosen().norm(xs, n);
+}
+
+auto distances(const float *x, const float *base, size_t stride,
+               const size_t *rows, size_t m, size_t n, float *out) noexcept -> void {
+  chosen().distances(x, base, stride, rows, m, n, out);
+}
+
+auto uniforms(const uint64_t *xs, size_t n, double *out) noexcept -> void {
+  chosen().uniforms(xs, n, out);
+}
+
+}
+}
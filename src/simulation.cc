@@ -5,6 +5,7 @@
 #include <string>
 #include <random>
 #include <vector>
+#include <memory>
 
 #include <cstring>
 #include <cassert>
@@ -16,14 +17,28 @@
 #include "wagner/network.hh"
 #include "wagner/n-sphere.hh"
 #include "wagner/model.hh"
+#include "wagner/migration.hh"
+#include "wagner/fenwick.hh"
+#include "wagner/snapshot.hh"
+#include "wagner/output.hh"
+#include "wagner/binary.hh"
+#include "wagner/checkpoint.hh"
 
 namespace wagner {
 
-void simulation(model m, size_t seed, size_t t_max, size_t communities,
+// The simulation, specialized for a model so the model tests are resolved at
+// compile time. It starts from the checkpoint 'saved' if not null. Returns
+// false if the run cannot start: no spatial network, or output files of the
+// checkpoint that cannot be reopened.
+template<model m>
+static auto run(size_t seed, size_t t_max, size_t communities,
                 size_t traits, double ext_max, double mig_max,
                 double aleph, double speciation, double radius,
-                float white_noise_std) noexcept {
-  const bool has_traits = m == model::euclidean_traits || m == model::fuzzy_traits;
+                float white_noise_std, sampler init,
+                boundary noise_boundary, output_format format,
+                size_t migration_threads, migration_draws draws,
+                size_t checkpoint_interval, const checkpoint_reader *saved) noexcept -> bool {
+  constexpr bool has_traits = m == model::euclidean_traits || m == model::fuzzy_traits;
 
   std::vector<size_t> speciation_per_t;
   std::vector<size_t> ext_per_t;
@@ -38,102 +53,117 @@ void simulation(model m, size_t seed, size_t t_max, size_t communities,
 
   size_t trials = 0; // Attempts to build the spatial networks.
   wagner::network<wagner::point> landscape;
-  do {
-    if (++trials > 100000) {
-      std::cout << "Terminating after 100 000 attempts were made to generate the spatial network.\n";
-      return;
+  if (saved) {
+    landscape = saved->landscape();
+    trials = saved->header().attempts;
+  } else {
+    do {
+      if (++trials > 100000) {
+        std::cout << "Terminating after 100 000 attempts were made to generate the spatial network.\n";
+        return false;
+      }
+      landscape.rgg(communities, radius, rng);
+    } while (!landscape.connected());
+
+    std::sprintf(buffer, "w-network-%lu.graphml", seed);
+    std::ofstream out_net(buffer);
+    out_net << landscape;
+    out_net.close();
+  }
+  auto const progress = saved ? saved->progress() : checkpoint_progress{};
+  if (saved) {
+    std::istringstream engines(progress.engines);
+    engines >> rng >> noise;
+    if (engines.fail()) {
+      return false;
+    }
+  }
+
+  auto const migration_schedule = migration_threads == 0 ? schedule::sequential
+                                                         : schedule::synchronous;
+  run_info const info{m, wagner_version, wagner_revision, seed, t_max, communities, radius,
+                      trials, traits, white_noise_std, init, noise_boundary,
+                      migration_schedule, draws, aleph, speciation, mig_max, ext_max};
+  bool const xml = format != output_format::binary;
+  bool const bin = format != output_format::xml;
+
+  // When resuming, what was written after the checkpoint is dropped.
+  std::ofstream out_info;
+  if (xml) {
+    std::sprintf(buffer, "w-%lu.xml", seed);
+    if (saved) {
+      if (!cut_output(buffer, progress.info_size)) {
+        return false;
+      }
+      out_info.open(buffer, std::ios::in | std::ios::out);
+      out_info.seekp(0, std::ios::end);
+      if (!out_info.good()) {
+        return false;
+      }
+    } else {
+      out_info.open(buffer);
+      write_xml_header(out_info, info);
     }
-    landscape.rgg(communities, radius, rng);
-  } while (!landscape.connected());
-
-  std::sprintf(buffer, "w-network-%lu.graphml", seed);
-  std::ofstream out_net(buffer);
-  out_net << landscape;
-  out_net.close();
-
-  std::sprintf(buffer, "w-%lu.xml", seed);
-  std::ofstream out_info(buffer);
-  out_info << "<wagner>\n";
-  out_info << "   <version>" << wagner_version << "</version>\n";
-  out_info << "   <revision>" << wagner_revision << "</revision>\n";
-  out_info << "   <model>" << m << "</model>\n";
-  out_info << "   <master_seed>" << seed << "</master_seed>\n";
-  out_info << "   <t_max>" << t_max << "</t_max>\n";
-  out_info << "   <communities>" << communities << "</communities>\n";
-  out_info << "   <radius>" << radius << "</radius>\n";
-  out_info << "   <attempts>" << trials << "</attempts>\n";
-  if (has_traits) {
-    out_info << "   <num_traits>" << traits << "</num_traits>\n";
-    out_info << "   <white_noise_std>" << white_noise_std << "</white_noise_std>\n";
   }
-  if (m != model::neutral) {
-    out_info << "   <aleph>" << aleph << "</aleph>\n";
+  binary_run_writer out_bin;
+  if (bin) {
+    std::sprintf(buffer, "w-%lu.bin", seed);
+    if (saved) {
+      if (!out_bin.reopen(buffer, info, landscape.order(), progress.bin_size, progress.bin_trees)) {
+        return false;
+      }
+    } else {
+      out_bin.open(buffer, info, landscape.values());
+    }
   }
-  out_info << "   <speciation>" << speciation << "</speciation>\n";
-  out_info << "   <migration>" << mig_max << "</migration>\n";
-  out_info << "   <extinction>" << ext_max << "</extinction>\n";
+
+  // Writes the w-species files while the simulation goes on:
+  wagner::snapshot_writer snapshots(landscape, seed, format);
 
   // Where the species are stored:
-  wagner::speciestree tree(wagner::random_n_sphere<float>(rng, traits, 0.5f)); // Starts with one species.
-  for (auto sp : tree) {
-    for (auto p : landscape) {
-      sp->add_to(p.first);
+  std::unique_ptr<wagner::speciestree> species_tree;
+  size_t n_pops;
+  size_t t = 0;
+  if (saved) {
+    species_tree.reset(new wagner::speciestree(saved->tree()));
+    n_pops = progress.populations;
+    t = progress.t;
+    speciation_per_t.assign(saved->speciation_per_t(), saved->speciation_per_t() + t);
+    ext_per_t.assign(saved->extinctions_per_t(), saved->extinctions_per_t() + t);
+    species_per_t.assign(saved->species_per_t(), saved->species_per_t() + t);
+  } else {
+    // Starts with one species.
+    species_tree.reset(new wagner::speciestree(wagner::random_n_sphere<float>(rng, traits, 0.5f, init)));
+    for (auto sp : *species_tree) {
+      for (vertex v = 0; v < landscape.order(); ++v) {
+        sp->add_to(v);
+      }
     }
+    assert(species_tree->num_species() == 1);
+    n_pops = landscape.order();
+  }
+  auto &tree = *species_tree;
+  if (has_traits) {
+    tree.update_distances();
   }
 
-  assert(tree.num_species() == 1);
-
-  size_t n_pops = landscape.order();
+  // Threads of the synchronous migration phase, if any:
+  std::unique_ptr<synchronous_migration> parallel_migration;
+  if (migration_schedule == schedule::synchronous) {
+    parallel_migration.reset(new synchronous_migration(migration_threads, seed));
+  }
 
   ////////////////////////////////
   //        SIMULATIONS         //
   ////////////////////////////////
-  size_t t = 0;
   for (; t <= t_max && n_pops != 0; ++t) {
     ////////////////
     // MIGRATION  //
     ////////////////
-    for (auto s0 : tree) {
-      auto const& presences = s0->get_locations();
-      for (auto const& presence : presences) {
-        auto const& neighbors = landscape.neighbors(presence.first);
-        for (auto const& location : neighbors) {
-          if (presences.find(location) == presences.end()) {
-            double mig = mig_max;
-
-            if (m != model::neutral) {
-              double delta = 0.0;
-              for (auto s1 : tree) {
-                if (s1 != s0) {
-                  auto const& presences1 = s1->get_locations();
-                  if (presences1.find(location) != presences1.end()) {
-                    if (m == model::euclidean_traits) {
-                      const auto dist = wagner::euclidean_distance(s0->traits(), s1->traits());
-                      assert(dist >= 0.0f && dist <= 1.0f);
-                      delta += 1.0 - dist;
-                    } else if (m == model::phylo_dist) {
-                      delta += 1.0 / (t - s0->get_mrca(*s1));
-                      break;
-                    } else if (m == model::fuzzy_traits) {
-                      const auto prox = 1.0 - wagner::euclidean_distance(s0->traits(), s1->traits());
-                      assert(prox >= 0.0f && prox <= 1.0f);
-                      if (prox > delta)
-                        delta = prox;
-                    }
-                  }
-                }
-              }
-              mig *= (m == model::fuzzy_traits? 1.0 - delta : exp(-aleph * delta));
-            }
-
-            if (!s0->is_in(location) && unif(rng) < mig) {
-              s0->add_to(location);
-              ++n_pops;
-            }
-          }
-
-        }
-      }
+    if (parallel_migration) {
+      n_pops += parallel_migration->run<m>(tree, landscape, t, mig_max, aleph, draws);
+    } else {
+      n_pops += migration<m>(tree, landscape, t, mig_max, aleph, rng, draws);
     }
 
     ////////////////
@@ -142,30 +172,22 @@ void simulation(model m, size_t seed, size_t t_max, size_t communities,
     std::binomial_distribution<> binom(n_pops, ext_max);
     size_t extinctions = binom(rng);
 
+    // Populations are drawn with a Fenwick tree over the sizes of the species,
+    // in the order of the tree:
+    std::vector<wagner::species*> ranked(tree.begin(), tree.end());
+    std::vector<ptrdiff_t> weights(ranked.size());
+    if (extinctions > 0) {
+      for (size_t r = 0; r < ranked.size(); ++r) weights[r] = ranked[r]->size();
+    }
+    wagner::fenwick<ptrdiff_t> pops(weights);
+    assert(extinctions == 0 || (size_t)pops.total() == n_pops);
+
     while (extinctions > 0) {
-      size_t i = (size_t)(unif(rng) * n_pops);
-      size_t j = 0;
-      wagner::species *species_to_die = nullptr;
-      for (auto s0 : tree) {
-        j += s0->size();
-        if (i < j) {
-          species_to_die = s0;
-          break;
-        }
-      }
-      assert(species_to_die != nullptr);
-      i = (size_t)(unif(rng) * species_to_die->size());
-      j = 0;
-
-      auto const& locations = species_to_die->get_locations();
-      for (auto const& location : locations) {
-        if (i == j) {
-          species_to_die->rmv_from(location.first);
-          break;
-        } else {
-          ++j;
-        }
-      }
+      auto const r = pops.find((ptrdiff_t)(unif(rng) * n_pops)).first;
+      wagner::species *species_to_die = ranked[r];
+      auto const i = (size_t)(unif(rng) * species_to_die->size());
+      species_to_die->rmv_from(species_to_die->get_locations().nth(i));
+      pops.add(r, -1);
       --n_pops;
       --extinctions;
     }
@@ -174,8 +196,9 @@ void simulation(model m, size_t seed, size_t t_max, size_t communities,
     // SPECIATION //
     ////////////////
     size_t n_groups = 0;
-    for (auto s0 : tree) {
-      n_groups += s0->up_groups(landscape);
+    for (size_t r = 0; r < ranked.size(); ++r) {
+      weights[r] = ranked[r]->up_groups(landscape);
+      n_groups += weights[r];
     }
     size_t speciation_events = 0;
     if (n_groups > 0) {
@@ -183,20 +206,13 @@ void simulation(model m, size_t seed, size_t t_max, size_t communities,
       speciation_events = binom2(rng);
     }
     speciation_per_t.push_back(speciation_events);
+    // Groups are not updated before the next time step, so the weights hold.
+    wagner::fenwick<ptrdiff_t> groups(speciation_events > 0 ? weights : std::vector<ptrdiff_t>{});
     while (speciation_events > 0) {
       // Select species.
-      size_t i = (size_t)(unif(rng) * n_groups);
-      size_t j = 0;
-      wagner::species *to_speciate = nullptr;
-      for (auto s0 : tree) {
-        j += s0->num_groups();
-        if (i < j) {
-          to_speciate = s0;
-          break;
-        }
-      }
-      assert(to_speciate != nullptr);
-      i = (size_t)(unif(rng) * to_speciate->num_groups());
+      auto const r = groups.find((ptrdiff_t)(unif(rng) * n_groups)).first;
+      wagner::species *to_speciate = ranked[r];
+      auto const i = (size_t)(unif(rng) * to_speciate->num_groups());
 
       // Speciate and get the new species:
       wagner::species *new_species = tree.speciate(to_speciate, t);
@@ -204,46 +220,134 @@ void simulation(model m, size_t seed, size_t t_max, size_t communities,
       assert(new_species->num_traits() == traits);
 
       // Transfer populations:
-      set<wagner::point> to_transfer = to_speciate->pop_group(i);
+      set<wagner::vertex> to_transfer = to_speciate->pop_group(i);
       new_species->add_to(to_transfer);
       --speciation_events;
     }
 
     // For all species: white noise
     if (has_traits) {
-      for (auto sp : tree) {
-        wagner::white_noise(sp->traits(), rng, noise, 0.5f);
-      }
+      tree.white_noise(rng, noise, 0.5f, noise_boundary);
+      tree.update_distances();
     }
 
     // Epilogue = remove extinct species from the most recent common ancestor
-    set<wagner::species*> to_rmv = tree.rmv_extinct(t);
-    ext_per_t.push_back(to_rmv.size());
+    ext_per_t.push_back(tree.rmv_extinct(t));
     species_per_t.push_back(tree.num_species());
 
     if (power_of_two(t)) {
       tree.stop(t);
-      out_info << "   <newick><t>" << t << "</t>" << tree.newick()
-               << "</newick>\n";
-      std::sprintf(buffer, "w-species-%lu-t%lu.xml", seed, t);
-      std::ofstream out_res(buffer);
-      out_res << "<extant_species>\n";
-      out_res << "  <t>" << t << "</t>\n";
-      for (auto s0 : tree) out_res << "  " << s0->get_info(t) << '\n';
-      out_res << "</extant_species>\n";
-      out_res.close();
+      if (xml) out_info << "   <newick><t>" << t << "</t>" << tree << "</newick>\n";
+      if (bin) out_bin.tree(t, tree);
+      snapshots.write(tree, t); // Written in the background.
+    }
+
+    if (checkpoint_interval != 0 && (t + 1) % checkpoint_interval == 0) {
+      // The output files are flushed first: the checkpoint records their size.
+      // No checkpoint is taken if they cannot be written.
+      checkpoint_progress now{format, migration_threads, checkpoint_interval, t + 1, n_pops,
+                              0, 0, 0, std::string{}};
+      bool good = true;
+      if (xml) {
+        out_info.flush();
+        good = good && out_info.good();
+        now.info_size = static_cast<size_t>(out_info.tellp());
+      }
+      if (bin) {
+        now.bin_size = out_bin.size();
+        now.bin_trees = out_bin.num_trees();
+        good = good && out_bin.good();
+      }
+      snapshots.wait();
+      std::ostringstream engines;
+      engines << rng << ' ' << noise;
+      now.engines = engines.str();
+      std::sprintf(buffer, "w-%lu.ckpt", seed);
+      if (!good || !write_checkpoint(buffer, info, now, landscape, tree, speciation_per_t.data(),
+                                     ext_per_t.data(), species_per_t.data())) {
+        std::cout << "Could not write the checkpoint " << buffer << ".\n";
+      }
     }
   } // end simulation
 
-  out_info << "   <speciation_per_t> ";
-  for (size_t i : speciation_per_t) out_info << i << ' ';
-  out_info << "</speciation_per_t>\n   <extinctions_per_t> ";
-  for (size_t i : ext_per_t) out_info << i << ' ';
-  out_info << "</extinctions_per_t>\n   <species_per_t> ";
-  for (size_t i : species_per_t) out_info << i << ' ';
-  out_info << "</species_per_t>\n";
-  out_info << "</wagner>\n";
-  out_info.close();
+  if (xml) {
+    write_xml_footer(out_info, speciation_per_t.data(), ext_per_t.data(),
+                     species_per_t.data(), species_per_t.size());
+    out_info.close();
+  }
+  if (bin) {
+    out_bin.close(speciation_per_t.data(), ext_per_t.data(),
+                  species_per_t.data(), species_per_t.size());
+  }
+  return true;
+}
+
+// Run the simulation of model 'm' (see run).
+static auto start(model m, size_t seed, size_t t_max, size_t communities,
+                  size_t traits, double ext_max, double mig_max,
+                  double aleph, double speciation, double radius,
+                  float white_noise_std, sampler init,
+                  boundary noise_boundary, output_format format,
+                  size_t migration_threads, migration_draws draws,
+                  size_t checkpoint_interval, const checkpoint_reader *saved) noexcept -> bool {
+  switch (m) {
+    case model::neutral:
+      return run<model::neutral>(seed, t_max, communities, traits, ext_max, mig_max,
+                                 aleph, speciation, radius, white_noise_std, init,
+                                 noise_boundary, format, migration_threads, draws,
+                                 checkpoint_interval, saved);
+    case model::phylo_dist:
+      return run<model::phylo_dist>(seed, t_max, communities, traits, ext_max, mig_max,
+                                    aleph, speciation, radius, white_noise_std, init,
+                                    noise_boundary, format, migration_threads, draws,
+                                    checkpoint_interval, saved);
+    case model::euclidean_traits:
+      return run<model::euclidean_traits>(seed, t_max, communities, traits, ext_max, mig_max,
+                                          aleph, speciation, radius, white_noise_std, init,
+                                          noise_boundary, format, migration_threads, draws,
+                                          checkpoint_interval, saved);
+    case model::fuzzy_traits:
+      return run<model::fuzzy_traits>(seed, t_max, communities, traits, ext_max, mig_max,
+                                      aleph, speciation, radius, white_noise_std, init,
+                                      noise_boundary, format, migration_threads, draws,
+                                      checkpoint_interval, saved);
+  }
+  return false;
+}
+
+void simulation(model m, size_t seed, size_t t_max, size_t communities,
+                size_t traits, double ext_max, double mig_max,
+                double aleph, double speciation, double radius,
+                float white_noise_std, sampler init,
+                boundary noise_boundary, output_format format,
+                size_t migration_threads, migration_draws draws,
+                size_t checkpoint_interval) noexcept {
+  start(m, seed, t_max, communities, traits, ext_max, mig_max, aleph, speciation,
+        radius, white_noise_std, init, noise_boundary, format, migration_threads,
+        draws, checkpoint_interval, nullptr);
+}
+
+auto resume(const char *path, size_t migration_threads,
+            size_t checkpoint_interval) noexcept -> bool {
+  checkpoint_reader saved;
+  if (!saved.open(path)) {
+    return false;
+  }
+  auto const info = saved.info();
+  auto const progress = saved.progress();
+  // The schedule is the one of the run, only the number of threads may change.
+  if (info.migration_schedule == schedule::sequential) {
+    migration_threads = 0;
+  } else if (migration_threads == 0) {
+    migration_threads = progress.migration_threads;
+  }
+  if (checkpoint_interval == 0) {
+    checkpoint_interval = progress.interval;
+  }
+  return start(info.m, info.seed, info.t_max, info.communities, info.num_traits,
+               info.extinction, info.migration, info.aleph, info.speciation, info.radius,
+               info.white_noise_std, info.init, info.noise_boundary, progress.format,
+               migration_threads, info.draws, checkpoint_interval, &saved);
 }
 
 } /* end namespace wagner */
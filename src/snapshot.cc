@@ -0,0 +1,188 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include "wagner/snapshot.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/binary.hh"
+
+namespace wagner {
+
+auto species_record::capture(const species &s) noexcept -> void {
+  id = s.id;
+  locations.clear();
+  groups.clear();
+  for (auto v : s.get_locations()) {
+    locations.push_back(v);
+    groups.push_back(s.group(v));
+  }
+  traits.assign(s.begin(), s.end());
+}
+
+auto species_record::centroid(network<point> const& landscape) const noexcept -> point {
+  // Same sums as species::centroid.
+  double x_ = 0.0;
+  double y_ = 0.0;
+  for (auto v : locations) {
+    x_ += landscape.value(v).x;
+    y_ += landscape.value(v).y;
+  }
+  x_ /= locations.size();
+  y_ /= locations.size();
+
+  return point(x_, y_);
+}
+
+auto species_record::write(std::ostream &os, network<point> const& landscape) const noexcept -> void {
+  write_species_xml(os, id, centroid(landscape), locations.data(), groups.data(),
+                    locations.size(), landscape.values().data(), traits.data(), traits.size());
+}
+
+snapshot::snapshot() noexcept : m_t{0}, m_size{0} {
+  //
+}
+
+auto snapshot::capture(const speciestree &tree, size_t t) noexcept -> void {
+  m_t = t;
+  m_size = 0;
+  for (auto s : tree) {
+    if (m_size == m_records.size()) {
+      m_records.emplace_back();
+    }
+    m_records[m_size++].capture(*s);
+  }
+}
+
+auto snapshot::t() const noexcept -> size_t {
+  return m_t;
+}
+
+auto snapshot::size() const noexcept -> size_t {
+  return m_size;
+}
+
+auto snapshot::write(std::ostream &os, network<point> const& landscape) const noexcept -> void {
+  os << "<extant_species>\n";
+  os << "  <t>" << m_t << "</t>\n";
+  for (size_t i = 0; i < m_size; ++i) {
+    os << "  ";
+    m_records[i].write(os, landscape);
+    os << '\n';
+  }
+  os << "</extant_species>\n";
+}
+
+auto snapshot::write_binary(std::ostream &os, network<point> const& landscape) const noexcept -> void {
+  binary_snapshot_header h{};
+  std::copy_n("WAGNSPC", 8, h.magic);
+  h.byte_order = binary_byte_order;
+  h.format_version = binary_format_version;
+  h.t = m_t;
+  h.num_species = m_size;
+  h.num_traits = m_size == 0 ? 0 : m_records[0].traits.size();
+  for (size_t i = 0; i < m_size; ++i) {
+    h.num_locations += m_records[i].locations.size();
+  }
+  binary_snapshot_layout const layout(h);
+
+  // The file is built in memory, padding included, and written at once.
+  auto bytes = std::vector<char>(layout.size, 0);
+  auto column = [&](size_t offset) { return bytes.data() + offset; };
+  std::memcpy(column(0), &h, sizeof(h));
+  size_t first = 0;
+  for (size_t i = 0; i < m_size; ++i) {
+    auto const& r = m_records[i];
+    uint64_t const id = r.id;
+    auto const c = r.centroid(landscape);
+    uint64_t const first64 = first;
+    auto const n = r.locations.size();
+    std::memcpy(column(layout.ids) + i * sizeof(uint64_t), &id, sizeof(id));
+    std::memcpy(column(layout.centroid_x) + i * sizeof(double), &c.x, sizeof(double));
+    std::memcpy(column(layout.centroid_y) + i * sizeof(double), &c.y, sizeof(double));
+    std::memcpy(column(layout.first_location) + i * sizeof(uint64_t), &first64, sizeof(first64));
+    std::memcpy(column(layout.vertices) + first * sizeof(uint32_t), r.locations.data(),
+                n * sizeof(uint32_t));
+    std::memcpy(column(layout.groups) + first * sizeof(int32_t), r.groups.data(),
+                n * sizeof(int32_t));
+    std::memcpy(column(layout.traits) + i * h.num_traits * sizeof(float), r.traits.data(),
+                r.traits.size() * sizeof(float));
+    first += n;
+  }
+  uint64_t const last = first;
+  std::memcpy(column(layout.first_location) + m_size * sizeof(uint64_t), &last, sizeof(last));
+  os.write(bytes.data(), bytes.size());
+}
+
+snapshot_writer::snapshot_writer(network<point> const& landscape, size_t seed,
+                                 output_format format) noexcept
+  : m_landscape(landscape), m_seed{seed}, m_format{format}, m_fill{0}, m_queued{-1}, m_writing{-1},
+    m_stop{false}, m_thread(&snapshot_writer::m_run, this) {
+  //
+}
+
+snapshot_writer::~snapshot_writer() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  m_thread.join();
+}
+
+auto snapshot_writer::write(const speciestree &tree, size_t t) noexcept -> void {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this] { return m_fill != m_queued && m_fill != m_writing; });
+  lock.unlock();
+
+  // The writer does not touch this buffer until it is queued.
+  m_buffers[m_fill].capture(tree, t);
+
+  lock.lock();
+  m_cond.wait(lock, [this] { return m_queued == -1; });
+  m_queued = m_fill;
+  m_fill ^= 1;
+  lock.unlock();
+  m_cond.notify_all();
+}
+
+auto snapshot_writer::wait() noexcept -> void {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this] { return m_queued == -1 && m_writing == -1; });
+}
+
+auto snapshot_writer::m_run() noexcept -> void {
+  char buffer[50];
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_cond.wait(lock, [this] { return m_queued != -1 || m_stop; });
+    if (m_queued == -1) {
+      return;
+    }
+    m_writing = m_queued;
+    m_queued = -1;
+    lock.unlock();
+    m_cond.notify_all();
+
+    auto const& s = m_buffers[m_writing];
+    if (m_format != output_format::binary) {
+      std::sprintf(buffer, "w-species-%lu-t%lu.xml", m_seed, s.t());
+      std::ofstream out_res(buffer);
+      s.write(out_res, m_landscape);
+      out_res.close();
+    }
+    if (m_format != output_format::xml) {
+      std::sprintf(buffer, "w-species-%lu-t%lu.bin", m_seed, s.t());
+      std::ofstream out_bin(buffer, std::ios::binary);
+      s.write_binary(out_bin, m_landscape);
+      out_bin.close();
+    }
+
+    lock.lock();
+    m_writing = -1;
+    m_cond.notify_all();
+  }
+}
+
+}
@@ -5,42 +5,45 @@
 #include <map>
 #include <set>
 #include <cassert>
+#include <algorithm>
 #include "wagner/common.hh"
 #include "wagner/tbranch.hh"
 #include "wagner/network.hh"
 #include "wagner/species.hh"
+#include "wagner/snapshot.hh"
 #include "wagner/point.hh"
+#include "wagner/occupancy.hh"
 
 namespace wagner {
 
-species::species(size_t i, size_t ntraits) noexcept
-  : tbranch(nullptr, nullptr, nullptr), id{i}, m_traits{std::vector<float>(ntraits, 0.0f)} {
+species::species(size_t i, trait_matrix *traits, occupancy *occ, size_t slot) noexcept
+  : tbranch(nullptr, nullptr, nullptr), m_traits{traits}, m_occupancy{occ},
+    m_slot{slot}, id{i} {
   //
 }
 
-species::species(size_t i, std::vector<float> const& starting_traits) noexcept
-  : tbranch(nullptr, nullptr, nullptr), id(i), m_traits{starting_traits} {
-  //
+auto species::slot() const noexcept -> size_t {
+  return m_slot;
 }
 
 auto species::num_traits() const noexcept -> size_t {
-  return m_traits.size();
+  return m_traits == nullptr ? 0 : m_traits->num_traits();
 }
 
-auto species::traits() noexcept -> std::vector<float>& {
-  return m_traits;
+auto species::traits() noexcept -> traits_view {
+  return m_traits == nullptr ? traits_view(nullptr, 0) : m_traits->view(m_slot);
 }
 
 auto species::operator[](size_t idx) noexcept -> float& {
-  return m_traits[idx];
+  return m_traits->row(m_slot)[idx];
 }
 
-auto species::begin() const noexcept -> std::vector<float>::const_iterator {
-  return m_traits.begin();
+auto species::begin() const noexcept -> const float* {
+  return m_traits == nullptr ? nullptr : m_traits->row(m_slot);
 }
 
-auto species::end() const noexcept -> std::vector<float>::const_iterator {
-  return m_traits.end();
+auto species::end() const noexcept -> const float* {
+  return begin() + num_traits();
 }
 
 auto species::size() const noexcept -> size_t {
@@ -48,106 +51,323 @@ auto species::size() const noexcept -> size_t {
 }
 
 auto species::num_groups() const noexcept -> size_t {
-  return m_groups;
+  return m_groups.size();
+}
+
+auto species::group(vertex v) const noexcept -> int {
+  auto const l = m_locations.label(v);
+  return l == -1 ? -1 : m_group_of[l];
 }
 
-auto species::is_in(const point &p) const noexcept -> bool {
-  return m_locations.find(p) != m_locations.end();
+auto species::is_in(vertex v) const noexcept -> bool {
+  return m_locations.contains(v);
 }
 
 auto species::extinct() const noexcept -> bool {
-  return m_locations.size() == 0;
+  return m_locations.empty();
 }
 
-auto species::pop_group(int g) noexcept -> set<point> {
-  set<point> gr;
-  for (auto i : m_locations) {
-    if (i.second == g) {
-      gr.insert(i.first);
-    }
+auto species::pop_group(int g) noexcept -> set<vertex> {
+  set<vertex> gr;
+  if (g < 0 || (size_t)g >= m_groups.size()) {
+    return gr;
   }
-  for (auto i : m_locations) {
-    if (gr.find(i.first) != gr.end()) {
-      auto const p = i.first;
-      m_locations.erase(p);
+  auto const l = m_groups[g];
+  for (auto v : m_locations) {
+    if (m_locations.label(v) == l) {
+      gr.insert(gr.end(), v);
     }
   }
+  for (auto v : gr) {
+    rmv_from(v);
+  }
   return gr;
 }
 
-auto species::get_locations() const noexcept -> map<point, int> const& {
+auto species::get_locations() const noexcept -> range const& {
   return m_locations;
 }
 
-auto species::up_groups(network<point> &n) noexcept -> size_t {
-  size_t ngr = 0;
-  for (auto i : m_locations) {
-    m_locations[i.first] = -1;
+auto species::m_new_label() noexcept -> int {
+  if (!m_free_labels.empty()) {
+    auto const l = m_free_labels.back();
+    m_free_labels.pop_back();
+    return l;
   }
-  for (auto i : m_locations) {
-    if (i.second == -1) {
-      m_locations[i.first] = ngr;
-      m_grouping(i.first, ngr, n);
-      ++ngr;
+  m_label_sizes.push_back(0);
+  m_label_mins.push_back(0);
+  return (int)m_label_sizes.size() - 1;
+}
+
+auto species::m_relabel(vertex v, int from, int to, network<point> const& n,
+                        std::vector<vertex> &queue) noexcept -> void {
+  queue.clear();
+  queue.push_back(v);
+  m_locations.set_label(v, to);
+  for (size_t head = 0; head < queue.size(); ++head) {
+    for (auto u : n.neighbors(queue[head])) {
+      if (m_locations.contains(u) && m_locations.label(u) == from) {
+        m_locations.set_label(u, to);
+        queue.push_back(u);
+      }
     }
   }
-  m_groups = ngr;
-  return ngr;
 }
 
-auto species::m_grouping(const point &p, int gid, network<point> &n) noexcept -> void {
-  auto ns = n.neighbors(p);
-  for (auto i : ns) {
-    if ((m_locations.find(i) != m_locations.end()) && m_locations[i] == -1) {
-      m_locations[i] = gid;
-      m_grouping(i, gid, n);
+auto species::up_groups(network<point> const& n) noexcept -> size_t {
+  auto queue = std::vector<vertex>{};
+
+  // Components that lost locations may have split. The removals of each
+  // component are replayed in order: if the neighbors of every removed location
+  // are still joined when it goes, the component is intact. This is checked with
+  // a search from one neighbor, which usually finds the others in a few steps.
+  // Otherwise, if the searches visit as many locations as the component holds,
+  // or if the smallest location is gone, the pieces are relabelled: each of them
+  // touches a removed location.
+  std::stable_sort(m_removed.begin(), m_removed.end(),
+                   [](std::pair<vertex, int> const& a, std::pair<vertex, int> const& b) {
+                     return a.second < b.second;
+                   });
+  auto seeds = std::vector<vertex>{};
+  auto removed = std::vector<std::pair<vertex, size_t>>{}; // Location, order.
+  auto seen = std::vector<bool>{}; // Removed locations visited by the search.
+  auto reached = std::vector<bool>{}; // Seeds joined to the first one.
+  auto stack = std::vector<size_t>{};
+  for (size_t i = 0; i < m_removed.size(); ) {
+    auto const l = m_removed[i].second;
+    removed.clear();
+    for (; i < m_removed.size() && m_removed[i].second == l; ++i) {
+      removed.emplace_back(m_removed[i].first, removed.size());
+    }
+    auto intact = removed.size() < m_label_sizes[l];
+    auto budget = m_label_sizes[l];
+    if (intact) {
+      std::sort(removed.begin(), removed.end());
+      auto const order = [&](vertex u) -> size_t { // Order of removal, or 0.
+        auto const it = std::lower_bound(removed.begin(), removed.end(),
+                                         std::make_pair(u, size_t{0}));
+        return it != removed.end() && it->first == u ? it->second + 1 : 0;
+      };
+      for (size_t k = 1; k <= removed.size() && intact; ++k) {
+        auto const r = m_removed[i - removed.size() + k - 1].first;
+        // Present when 'r' is removed: labelled 'l', or removed later.
+        auto const marked = [&](vertex u) -> bool {
+          if (m_locations.contains(u) && m_locations.label(u) == l) return false;
+          auto const o = order(u);
+          return o <= k || seen[o - 1];
+        };
+        auto const mark = [&](vertex u) {
+          if (m_locations.contains(u) && m_locations.label(u) == l) {
+            m_locations.set_label(u, -2);
+          } else {
+            seen[order(u) - 1] = true;
+          }
+        };
+        seen.assign(removed.size(), false);
+        seeds.clear();
+        for (auto u : n.neighbors(r)) {
+          if (!marked(u)) {
+            seeds.push_back(u);
+          }
+        }
+        if (r == m_label_mins[l] || seeds.empty()) {
+          intact = false;
+          break;
+        }
+        // In dense landscapes the neighbors are usually joined by direct edges:
+        // try that first (the neighbor lists and the seeds are sorted).
+        reached.assign(seeds.size(), false);
+        reached[0] = true;
+        stack.assign(1, 0);
+        size_t found = 1;
+        while (!stack.empty() && found < seeds.size()) {
+          auto const ns = n.neighbors(seeds[stack.back()]);
+          stack.pop_back();
+          auto it = ns.begin();
+          for (size_t j = 0; j < seeds.size() && it != ns.end(); ) {
+            if (*it < seeds[j]) {
+              ++it;
+            } else if (seeds[j] < *it) {
+              ++j;
+            } else {
+              if (!reached[j]) {
+                reached[j] = true;
+                stack.push_back(j);
+                ++found;
+              }
+              ++it;
+              ++j;
+            }
+          }
+        }
+        if (found == seeds.size()) {
+          continue;
+        }
+        // Otherwise search from the first neighbor, marking visited locations
+        // with label -2, until all the others are found.
+        found = 1;
+        queue.clear();
+        queue.push_back(seeds[0]);
+        mark(seeds[0]);
+        for (size_t head = 0; head < queue.size() && found < seeds.size() &&
+                              queue.size() < budget; ++head) {
+          for (auto u : n.neighbors(queue[head])) {
+            if (!marked(u)) {
+              mark(u);
+              queue.push_back(u);
+              found += std::binary_search(seeds.begin(), seeds.end(), u);
+            }
+          }
+        }
+        for (auto u : queue) {
+          if (m_locations.contains(u) && m_locations.label(u) == -2) {
+            m_locations.set_label(u, l);
+          }
+        }
+        intact = found == seeds.size();
+        budget -= min2(budget, queue.size());
+      }
+    }
+    if (intact) {
+      m_label_sizes[l] -= removed.size();
+      continue;
+    }
+    for (auto const& r : removed) {
+      for (auto u : n.neighbors(r.first)) {
+        if (m_locations.contains(u) && m_locations.label(u) == l) {
+          auto const piece = m_new_label();
+          m_relabel(u, l, piece, n, queue);
+          m_label_sizes[piece] = queue.size();
+          m_label_mins[piece] = *std::min_element(queue.begin(), queue.end());
+        }
+      }
+    }
+    m_label_sizes[l] = 0;
+    m_free_labels.push_back(l);
+  }
+
+  // New locations join the components of their neighbors, merging them when
+  // they bridge several (the smaller component takes the label of the larger).
+  for (auto v : m_added) {
+    if (!m_locations.contains(v) || m_locations.label(v) != -1) {
+      continue;
+    }
+    auto l = -1;
+    for (auto u : n.neighbors(v)) {
+      if (!m_locations.contains(u)) {
+        continue;
+      }
+      auto const lu = m_locations.label(u);
+      if (lu == -1 || lu == l) {
+        continue;
+      }
+      if (l == -1) {
+        l = lu;
+        m_locations.set_label(v, l);
+        ++m_label_sizes[l];
+        m_label_mins[l] = min2(m_label_mins[l], v);
+      } else {
+        auto from = lu, to = l;
+        if (m_label_sizes[lu] > m_label_sizes[l]) {
+          std::swap(from, to);
+        }
+        m_relabel(from == lu ? u : v, from, to, n, queue);
+        m_label_sizes[to] += m_label_sizes[from];
+        m_label_mins[to] = min2(m_label_mins[to], m_label_mins[from]);
+        m_label_sizes[from] = 0;
+        m_free_labels.push_back(from);
+        l = to;
+      }
+    }
+    if (l == -1) {
+      l = m_new_label();
+      m_locations.set_label(v, l);
+      m_label_sizes[l] = 1;
+      m_label_mins[l] = v;
+    }
+  }
+  m_added.clear();
+  m_removed.clear();
+
+  m_groups.clear();
+  for (size_t l = 0; l < m_label_sizes.size(); ++l) {
+    if (m_label_sizes[l] > 0) {
+      m_groups.push_back((int)l);
     }
   }
+  std::sort(m_groups.begin(), m_groups.end(), [this](int a, int b) {
+    return m_label_mins[a] < m_label_mins[b];
+  });
+  m_group_of.assign(m_label_sizes.size(), -1);
+  for (size_t g = 0; g < m_groups.size(); ++g) {
+    m_group_of[m_groups[g]] = (int)g;
+  }
+  return m_groups.size();
 }
 
-auto species::add_to(const point &p) noexcept -> void {
-  m_locations[p] = -1;
+auto species::add_to(vertex v) noexcept -> void {
+  if (m_locations.contains(v)) {
+    return;
+  }
+  m_locations.insert(v);
+  m_added.push_back(v);
+  if (m_occupancy != nullptr) {
+    m_occupancy->add(v, this);
+  }
 }
 
-auto species::add_to(const set<point> &ps) noexcept -> void {
-  for (auto p : ps) {
-    add_to(p);
+auto species::add_to(const set<vertex> &vs) noexcept -> void {
+  for (auto v : vs) {
+    add_to(v);
   }
 }
 
-auto species::rmv_from(const point &p) noexcept -> void {
-  m_locations.erase(p);
+auto species::rmv_from(vertex v) noexcept -> void {
+  if (!m_locations.contains(v)) {
+    return;
+  }
+  if (m_locations.label(v) != -1) {
+    m_removed.emplace_back(v, m_locations.label(v));
+  }
+  m_locations.erase(v);
+  if (m_occupancy != nullptr) {
+    m_occupancy->rmv(v, this);
+  }
 }
 
 auto species::num_differences(const species &s) const noexcept -> size_t {
   size_t delta = 0;
-  for (int i = 0; i < m_traits.size(); ++i)
-    delta += m_traits[i] != s.m_traits[i];
+  auto const xs = begin(), ys = s.begin();
+  for (size_t i = 0; i < num_traits(); ++i)
+    delta += xs[i] != ys[i];
   return delta;
 }
 
 auto species::same_traits_as(const species &s) const noexcept -> bool {
-  for (int i = 0; i < m_traits.size(); ++i) {
-    if (m_traits[i] != s.m_traits[i]) {
-      return false;
-    }
+  return std::equal(begin(), end(), s.begin());
+}
+
+// Number of nodes between 't' and the root.
+static auto depth(const tbranch *t) noexcept -> size_t {
+  size_t d = 0;
+  for (; t->parent() != nullptr; t = t->parent()) {
+    ++d;
   }
-  return true;
+  return d;
 }
 
 auto species::get_mrca(const species &s) const noexcept -> size_t {
-  tbranch *p = parent();
-  set<tbranch *> parents;
-  while (p != nullptr) {
-    parents.insert(p);
-    p = p->parent();
+  const tbranch *p0 = parent();
+  const tbranch *p1 = s.parent();
+  assert(p0 != nullptr && p1 != nullptr);
+  auto d0 = depth(p0), d1 = depth(p1);
+  for (; d0 > d1; --d0) p0 = p0->parent();
+  for (; d1 > d0; --d1) p1 = p1->parent();
+  while (p0 != p1) {
+    p0 = p0->parent();
+    p1 = p1->parent();
   }
-  p = s.parent();
-  assert(p != nullptr);
-  while (parents.find(p) == parents.end()) {
-    p = p->parent();
-  }
-  return p->end_date();
+  return p0->end_date();
 }
 
 auto species::get_mrca(const set<tbranch *> &ps) const noexcept -> size_t {
@@ -175,45 +395,47 @@ auto species::operator>(const species &s) const noexcept -> bool {
   return id > s.id;
 }
 
-auto species::operator&(species &s) const noexcept -> set<point> {
-  set<point> l;
-  auto l0 = get_locations();
-  auto l1 = s.get_locations();
-  for (auto const& i : l0) {
-    if (l1.find(i.first) != l1.end()) {
-      l.insert(i.first);
-    }
+auto species::operator&(species &s) const noexcept -> set<vertex> {
+  set<vertex> l;
+  for (auto v : m_locations & s.m_locations) {
+    l.insert(l.end(), v);
   }
   return l;
 }
 
+auto species::co_occurrences(const species &s) const noexcept -> size_t {
+  return m_locations.common(s.m_locations);
+}
+
 auto species::name() const noexcept -> std::string {
   std::ostringstream o;
   o << "species" << id;
   return o.str();
 }
 
-auto species::newick() const noexcept -> std::string {
-  std::ostringstream o;
-  o << "species" << id << ':' << parent_distance();
-  return o.str();
+auto species::write_name(std::ostream &os) const noexcept -> void {
+  os << "species" << id;
+}
+
+auto species::centroid(network<point> const& n) const noexcept -> point {
+  double x_ = 0.0;
+  double y_ = 0.0;
+
+  for (auto v : m_locations) {
+    x_ += n.value(v).x;
+    y_ += n.value(v).y;
+  }
+  x_ /= m_locations.size();
+  y_ /= m_locations.size();
+
+  return point(x_, y_);
 }
 
-auto species::get_info(size_t time) const noexcept -> std::string {
+auto species::get_info(size_t, network<point> const& landscape) const noexcept -> std::string {
+  species_record r;
+  r.capture(*this);
   std::ostringstream oss;
-  oss << "<species> <id>" << id << "</id> <centroid>"
-      << centroid(m_locations) << "</centroid> <locations>";
-  for (auto i : m_locations) {
-    oss << " <vertex><position>" << i.first << "</position><group>" << i.second
-        << "</group></vertex>";
-  }
-  oss << "</locations> <traits>[";
-  auto const n = m_traits.size();
-  if (n) {
-    oss << m_traits[0];
-    for (auto i = 1u; i < n; ++i) oss << ", " << m_traits[i];
-  }
-  oss << "]</traits></species>";
+  r.write(oss, landscape);
   return oss.str();
 }
 
@@ -1,33 +1,105 @@
 #include <ostream>
 #include <string>
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include "wagner/common.hh"
 #include "wagner/speciestree.hh"
 #include "wagner/tbranch.hh"
 #include "wagner/species.hh"
 #include "wagner/point.hh"
 #include "wagner/n-sphere.hh"
+#include "wagner/simd.hh"
 
 namespace wagner {
 
-speciestree::speciestree(std::vector<float> const& traits) noexcept {
+speciestree::speciestree(std::vector<float> const& traits) noexcept
+    : m_num_slots{0}, m_traits{traits.size()}, m_track_distances{false},
+      m_mrca_dirty{true} {
   m_id_count = 0;
-  species *s0 = new species(m_id_count++, traits);
+  auto const slot = m_take_slot();
+  m_traits.reserve(slot);
+  std::copy(traits.begin(), traits.end(), m_traits.row(slot));
+  species *s0 = m_species.create(m_id_count++, &m_traits, &m_occupancy, slot);
   m_tips.insert(s0);
   m_start_date = 0;
   m_root = s0;
 }
 
+speciestree::speciestree(tree_columns const& c) noexcept
+    : m_root{nullptr}, m_start_date{c.start_date}, m_id_count{c.id_count},
+      m_free_slots(c.free_slots, c.free_slots + c.num_free_slots),
+      m_num_slots{c.num_slots}, m_traits{c.num_traits}, m_track_distances{false},
+      m_mrca_dirty{true} {
+  if (m_num_slots > 0) {
+    m_traits.reserve(m_num_slots - 1);
+  }
+  // In preorder, each node is the next child of the last internal node that
+  // still misses one.
+  auto open = std::vector<tbranch*>{};
+  size_t k = 0; // Next species.
+  for (size_t i = 0; i < c.num_nodes; ++i) {
+    tbranch *parent = open.empty() ? nullptr : open.back();
+    tbranch *node;
+    if (c.leaves[i]) {
+      species *s = m_species.create(c.ids[k], &m_traits, &m_occupancy, c.slots[k]);
+      std::copy_n(c.traits + k * c.num_traits, c.num_traits, m_traits.row(c.slots[k]));
+      for (auto l = c.first_location[k]; l < c.first_location[k + 1]; ++l) {
+        s->add_to(c.locations[l]);
+      }
+      m_tips.insert(s);
+      node = s;
+      ++k;
+    } else {
+      node = m_branches.create(nullptr, nullptr, nullptr);
+    }
+    node->set_parent(parent);
+    node->set_end_date(c.end_dates[i]);
+    if (parent == nullptr) {
+      m_root = node;
+    } else if (parent->left() == nullptr) {
+      parent->set_left(node);
+    } else {
+      parent->set_right(node);
+      open.pop_back();
+    }
+    if (!c.leaves[i]) {
+      open.push_back(node);
+    }
+  }
+}
+
 speciestree::~speciestree() noexcept {
-  delete m_root;
+  //
 }
 
 auto speciestree::num_species() noexcept -> size_t {
   return m_tips.size();
 }
 
-auto speciestree::rmv_extinct(size_t date) noexcept -> set<species*> {
-  set<species*> to_rmv;
+auto speciestree::root() const noexcept -> const tbranch* {
+  return m_root;
+}
+
+auto speciestree::start_date() const noexcept -> size_t {
+  return m_start_date;
+}
+
+auto speciestree::id_count() const noexcept -> size_t {
+  return m_id_count;
+}
+
+auto speciestree::num_slots() const noexcept -> size_t {
+  return m_num_slots;
+}
+
+auto speciestree::free_slots() const noexcept -> std::vector<size_t> const& {
+  return m_free_slots;
+}
+
+auto speciestree::rmv_extinct(size_t date) noexcept -> size_t {
+  std::vector<species*> to_rmv;
   for (auto i : m_tips) {
     species *s = i;
     if (s->extinct()) {
@@ -41,6 +113,7 @@ auto speciestree::rmv_extinct(size_t date) noexcept -> set<species*> {
         m_start_date += new_m_root->end_date() - m_start_date;
         m_root = new_m_root;
         m_root->set_parent(nullptr);
+        m_branches.destroy(old_m_root);
       } else {
         tbranch *parent = s->parent();
         tbranch *gramps = parent->parent();
@@ -52,20 +125,25 @@ auto speciestree::rmv_extinct(size_t date) noexcept -> set<species*> {
         } else {
           gramps->set_right(other);
         }
+        gramps->invalidate();
+        m_branches.destroy(parent);
       }
-      to_rmv.insert(i);
+      to_rmv.push_back(i);
     }
   }
 
+  m_mrca_dirty |= !to_rmv.empty();
   for (auto i : to_rmv) {
     m_tips.erase(i);
+    m_free_slots.push_back(i->slot());
+    m_species.destroy(i);
   }
-  return to_rmv;
+  return to_rmv.size();
 }
 
 auto speciestree::speciate(species* p, size_t date) noexcept -> species* {
   species *s0 = p;
-  tbranch *new_parent = new tbranch(s0->parent(), nullptr, nullptr);
+  tbranch *new_parent = m_branches.create(s0->parent(), nullptr, nullptr);
   new_parent->set_end_date(date);
 
   // If the species undergoing speciation has a parent:
@@ -79,13 +157,18 @@ auto speciestree::speciate(species* p, size_t date) noexcept -> species* {
     m_start_date += date;
   }
 
-//  species *s1 = new species(m_id_count++);
-  species *s1 = new species(m_id_count++, p->traits());
+  auto const slot = m_take_slot();
+  m_traits.copy(p->slot(), slot);
+  species *s1 = m_species.create(m_id_count++, &m_traits, &m_occupancy, slot);
+  if (m_track_distances) {
+    m_distances.copy(p->slot(), s1->slot());
+  }
   s1->set_parent(new_parent);
 
   new_parent->set_left(s0);
   new_parent->set_right(s1);
   s0->set_parent(new_parent);
+  new_parent->invalidate();
 
   // Change the m_root if the species undergoing speciation is also the m_root
   // of the tree
@@ -95,9 +178,67 @@ auto speciestree::speciate(species* p, size_t date) noexcept -> species* {
 
   // Add new species
   m_tips.insert(s1);
+  m_mrca_dirty = true;
   return s1;
 }
 
+auto speciestree::m_take_slot() noexcept -> size_t {
+  if (m_free_slots.empty()) {
+    return m_num_slots++;
+  }
+  auto const slot = m_free_slots.back();
+  m_free_slots.pop_back();
+  return slot;
+}
+
+auto speciestree::traits() noexcept -> trait_matrix& {
+  return m_traits;
+}
+
+auto speciestree::white_noise(std::mt19937_64& rng, std::normal_distribution<float>& d,
+                              float radius, boundary b) noexcept -> void {
+  auto slots = std::vector<size_t>{};
+  slots.reserve(m_tips.size());
+  for (auto s : m_tips) {
+    slots.push_back(s->slot());
+  }
+  m_traits.white_noise(slots.data(), slots.size(), rng, d, radius, b);
+}
+
+auto speciestree::update_distances() noexcept -> void {
+  m_track_distances = true;
+  m_distances.reserve(m_num_slots - 1);
+  auto slots = std::vector<size_t>{};
+  slots.reserve(m_tips.size());
+  for (auto s : m_tips) {
+    slots.push_back(s->slot());
+  }
+  // Each row is compared with all the rows after it in one batch. Rows are
+  // zero-padded, so comparing whole strides gives the same distances without
+  // the scalar tail.
+  auto const stride = m_traits.stride();
+  auto dists = std::vector<float>(slots.size());
+  for (size_t i = 0; i + 1 < slots.size(); ++i) {
+    auto const m = slots.size() - i - 1;
+    simd::distances(m_traits.row(slots[i]), m_traits.row(0), stride,
+                    &slots[i + 1], m, stride, dists.data());
+    for (size_t k = 0; k < m; ++k) {
+      m_distances.set(slots[i], slots[i + 1 + k], dists[k]);
+    }
+  }
+  for (auto slot : slots) {
+    m_distances.set(slot, slot, 0.0f);
+  }
+}
+
+auto speciestree::mrca(const species &s0, const species &s1) noexcept -> size_t {
+  if (m_mrca_dirty) {
+    m_mrca.build(m_root);
+    m_mrca_dirty = false;
+  }
+  return m_mrca(&s0, &s1)->end_date();
+}
+
 auto speciestree::stop(size_t date) noexcept -> void {
   for (auto i : m_tips) {
     i->set_end_date(date);
@@ -108,24 +249,36 @@ auto speciestree::newick() const noexcept -> std::string {
   return (m_root == nullptr) ? ";" : m_root->newick();
 }
 
-auto speciestree::begin() noexcept -> set<species*>::iterator {
+auto speciestree::write_newick(std::ostream &os) const noexcept -> void {
+  if (m_root == nullptr) {
+    os << ';';
+  } else {
+    m_root->write_newick(os);
+  }
+}
+
+auto speciestree::residents(vertex v) const noexcept -> species_set const& {
+  return m_occupancy.residents(v);
+}
+
+auto speciestree::begin() noexcept -> species_set::iterator {
   return m_tips.begin();
 }
 
-auto speciestree::end() noexcept -> set<species*>::iterator {
+auto speciestree::end() noexcept -> species_set::iterator {
   return m_tips.end();
 }
 
-auto speciestree::begin() const noexcept -> set<species*>::const_iterator {
+auto speciestree::begin() const noexcept -> species_set::const_iterator {
   return m_tips.begin();
 }
 
-auto speciestree::end() const noexcept -> set<species*>::const_iterator {
+auto speciestree::end() const noexcept -> species_set::const_iterator {
   return m_tips.end();
 }
 
 auto operator<<(std::ostream &os, const speciestree &t) noexcept -> std::ostream& {
-  os << t.newick();
+  t.write_newick(os);
   return os;
 }
 
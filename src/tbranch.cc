@@ -2,19 +2,20 @@
 #include <sstream>
 #include <ostream>
 #include <string>
+#include <vector>
 #include "wagner/common.hh"
 #include "wagner/tbranch.hh"
 
 namespace wagner {
 
 tbranch::tbranch(tbranch *p, tbranch *l, tbranch *r) noexcept
-    : m_parent(p), m_left(l), m_right(r) {
+    : m_parent(p), m_left(l), m_right(r), m_euler(0), m_edges(0), m_level(0),
+      m_max_end_date(0), m_stale(true) {
   m_end_date = 0;
 }
 
 tbranch::~tbranch() noexcept {
-  delete m_left;
-  delete m_right;
+  //
 }
 
 auto tbranch::parent() const noexcept -> tbranch* {
@@ -59,16 +60,56 @@ auto tbranch::end_date() const noexcept -> size_t {
 
 auto tbranch::set_end_date(size_t date) noexcept -> void {
   m_end_date = date;
+  if (leaf() && m_parent != nullptr) {
+    m_parent->invalidate();
+  }
+}
+
+auto tbranch::invalidate() noexcept -> void {
+  m_stale = true;
+  for (tbranch *t = m_parent; t != nullptr && !t->m_stale; t = t->m_parent) {
+    t->m_stale = true;
+  }
+}
+
+auto tbranch::m_update() const noexcept -> void {
+  // Post-order walk of the stale internal nodes: the ancestors of a stale node
+  // are stale too, so fresh nodes are roots of fresh subtrees.
+  auto stale = [](const tbranch *t) { return !t->leaf() && t->m_stale; };
+  if (!stale(this)) {
+    return;
+  }
+  std::vector<const tbranch*> stack(1, this);
+  while (!stack.empty()) {
+    const tbranch *t = stack.back();
+    if (stale(t->m_left)) {
+      stack.push_back(t->m_left);
+    } else if (stale(t->m_right)) {
+      stack.push_back(t->m_right);
+    } else {
+      t->m_edges = 2 + t->m_left->edges() + t->m_right->edges();
+      t->m_level = 1 + max2(t->m_left->level(), t->m_right->level());
+      t->m_max_end_date = max2(t->m_left->max_end_date(), t->m_right->max_end_date());
+      t->m_stale = false;
+      stack.pop_back();
+    }
+  }
+}
+
+auto tbranch::euler() const noexcept -> size_t {
+  return m_euler;
+}
+
+auto tbranch::set_euler(size_t pos) noexcept -> void {
+  m_euler = pos;
 }
 
 auto tbranch::max_end_date() const noexcept -> size_t {
   if (leaf()) {
     return m_end_date;
-  } else {
-    const int l_max = m_left->max_end_date();
-    const int r_max = m_right->max_end_date();
-    return max2(l_max, r_max);
   }
+  m_update();
+  return m_max_end_date;
 }
 
 auto tbranch::parent_distance() const noexcept -> size_t {
@@ -76,15 +117,28 @@ auto tbranch::parent_distance() const noexcept -> size_t {
 }
 
 auto tbranch::total_distance() const noexcept -> size_t {
-  return (m_parent == nullptr) ? 0 : parent_distance() + m_parent->total_distance();
+  // The distances to the parents add up to the distance to the root.
+  const tbranch *t = this;
+  while (t->m_parent != nullptr) {
+    t = t->m_parent;
+  }
+  return m_end_date - t->m_end_date;
 }
 
 auto tbranch::nodes() const noexcept -> size_t {
-  return (m_parent == nullptr) ? 0 : 1 + m_parent->nodes();
+  size_t n = 0;
+  for (const tbranch *t = m_parent; t != nullptr; t = t->m_parent) {
+    ++n;
+  }
+  return n;
 }
 
 auto tbranch::edges() const noexcept -> size_t {
-  return (m_left == nullptr) ? 0 : 2 + m_left->edges() + m_right->edges();
+  if (leaf()) {
+    return 0;
+  }
+  m_update();
+  return m_edges;
 }
 
 auto tbranch::leaves() const noexcept -> size_t {
@@ -92,26 +146,61 @@ auto tbranch::leaves() const noexcept -> size_t {
 }
 
 auto tbranch::strictly_binary() const noexcept -> bool {
-  if (m_left == nullptr && m_right == nullptr)
-    return true;
-  else if ((m_left == nullptr && m_right != nullptr) || (m_left != nullptr && m_right == nullptr))
-    return false;
-  else
-    return m_left->strictly_binary() && m_right->strictly_binary();
+  std::vector<const tbranch*> stack(1, this);
+  while (!stack.empty()) {
+    const tbranch *t = stack.back();
+    stack.pop_back();
+    if ((t->m_left == nullptr) != (t->m_right == nullptr)) {
+      return false;
+    }
+    if (t->m_left != nullptr) {
+      stack.push_back(t->m_left);
+      stack.push_back(t->m_right);
+    }
+  }
+  return true;
 }
 
 auto tbranch::level() const noexcept -> size_t {
-  return leaf() ? 0 : 1 + max2(m_left->level(), m_right->level());
+  if (leaf()) {
+    return 0;
+  }
+  m_update();
+  return m_level;
 }
 
 auto tbranch::newick() const noexcept -> std::string {
   std::ostringstream o;
-  o << "(" << m_left->newick() << "," << m_right->newick()
-    << "):" << parent_distance();
-  if (root()) {
-    o << ";";
-  }
+  write_newick(o);
   return o.str();
 }
 
+auto tbranch::write_newick(std::ostream &os) const noexcept -> void {
+  const tbranch *t = this;
+  for (;;) {
+    // Down the left-most path:
+    for (; !t->leaf(); t = t->m_left) {
+      os << '(';
+    }
+    t->write_name(os);
+    os << ':' << t->parent_distance();
+    // Up until a node whose right subtree is still to be written:
+    for (; t != this && t == t->m_parent->m_right; t = t->m_parent) {
+      os << "):" << t->m_parent->parent_distance();
+    }
+    if (t == this) {
+      break;
+    }
+    os << ',';
+    t = t->m_parent->m_right;
+  }
+  if (root() && !leaf()) {
+    os << ';';
+  }
+}
+
+auto tbranch::write_name(std::ostream &) const noexcept -> void {
+  //
+}
+
 }
@@ -0,0 +1,51 @@
+#include "wagner/thread_pool.hh"
+
+namespace wagner {
+
+thread_pool::thread_pool(size_t n) noexcept : m_running{0}, m_stop{false} {
+  if (n == 0) {
+    n = 1;
+  }
+  m_workers.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    m_workers.emplace_back(&thread_pool::m_run, this);
+  }
+}
+
+thread_pool::~thread_pool() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_work.notify_all();
+  for (auto &w : m_workers) {
+    w.join();
+  }
+}
+
+auto thread_pool::wait() noexcept -> void {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_tasks.empty() && m_running == 0; });
+}
+
+auto thread_pool::m_run() noexcept -> void {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_work.wait(lock, [this] { return !m_tasks.empty() || m_stop; });
+    if (m_tasks.empty()) {
+      return;
+    }
+    auto task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    ++m_running;
+    lock.unlock();
+
+    task();
+
+    lock.lock();
+    --m_running;
+    m_done.notify_all();
+  }
+}
+
+}
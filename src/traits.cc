@@ -0,0 +1,38 @@
+#include <vector>
+#include <algorithm>
+#include "wagner/common.hh"
+#include "wagner/traits.hh"
+
+namespace wagner {
+
+trait_matrix::trait_matrix(size_t ntraits) noexcept
+  : m_ntraits{ntraits}, m_stride{(ntraits + 15) / 16 * 16}, m_rows{0} {
+  //
+}
+
+auto trait_matrix::reserve(size_t slot) noexcept -> void {
+  if (slot < m_rows) {
+    return;
+  }
+  size_t rows = max2(m_rows * 2, (size_t)16);
+  while (rows <= slot) {
+    rows *= 2;
+  }
+  m_x.resize(rows * m_stride, 0.0f);
+  m_rows = rows;
+}
+
+auto trait_matrix::copy(size_t from, size_t to) noexcept -> void {
+  reserve(max2(from, to));
+  std::copy_n(row(from), m_stride, row(to));
+}
+
+auto trait_matrix::white_noise(const size_t *slots, size_t m, std::mt19937_64& rng,
+                               std::normal_distribution<float>& d, float radius,
+                               boundary b) noexcept -> void {
+  for (size_t k = 0; k < m; ++k) {
+    wagner::white_noise(row(slots[k]), m_ntraits, rng, d, radius, b);
+  }
+}
+
+}
@@ -0,0 +1,34 @@
+#include "wagner/uniforms.hh"
+#include "wagner/simd.hh"
+
+namespace wagner {
+
+uniform_buffer::uniform_buffer(std::mt19937_64 &rng, size_t block) noexcept
+  : m_rng(rng), m_raw(block == 0 ? 1 : block), m_draws(m_raw.size()), m_next{0}, m_size{0} {
+  //
+}
+
+uniform_buffer::~uniform_buffer() noexcept {
+  give_back();
+}
+
+auto uniform_buffer::m_refill() noexcept -> void {
+  m_saved = m_rng;
+  for (auto &x : m_raw) {
+    x = m_rng();
+  }
+  simd::uniforms(m_raw.data(), m_raw.size(), m_draws.data());
+  m_next = 0;
+  m_size = m_raw.size();
+}
+
+auto uniform_buffer::give_back() noexcept -> void {
+  if (m_next < m_size) {
+    m_rng = m_saved;
+    m_rng.discard(m_next);
+  }
+  m_next = 0;
+  m_size = 0;
+}
+
+}
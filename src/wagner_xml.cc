@@ -0,0 +1,47 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include "wagner/binary.hh"
+
+// Converts the binary output of a run (w-<seed>.bin and the
+// w-species-<seed>-t<t>.bin files next to it) to the XML output.
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " w-<seed>.bin\n";
+    return 1;
+  }
+
+  wagner::binary_run_reader run;
+  if (!run.open(argv[1])) {
+    std::cerr << "Cannot read " << argv[1] << '\n';
+    return 1;
+  }
+
+  // The other files are in the same directory as the run file.
+  std::string dir = argv[1];
+  auto const slash = dir.find_last_of('/');
+  dir = slash == std::string::npos ? std::string{} : dir.substr(0, slash + 1);
+
+  char buffer[50];
+  auto const seed = run.header().seed;
+  std::sprintf(buffer, "w-%lu.xml", seed);
+  std::ofstream out_info(dir + buffer);
+  run.write_xml(out_info);
+  out_info.close();
+
+  auto const positions = run.positions();
+  for (size_t i = 0; i < run.num_trees(); ++i) {
+    std::sprintf(buffer, "w-species-%lu-t%lu.bin", seed, run.tree_time(i));
+    wagner::binary_snapshot_reader species;
+    if (!species.open((dir + buffer).c_str())) {
+      continue;
+    }
+    std::sprintf(buffer, "w-species-%lu-t%lu.xml", seed, run.tree_time(i));
+    std::ofstream out_res(dir + buffer);
+    species.write_xml(out_res, positions);
+    out_res.close();
+  }
+
+  return 0;
+}
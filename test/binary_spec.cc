@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <string>
+#include "gtest/gtest.h"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/snapshot.hh"
+#include "wagner/output.hh"
+#include "wagner/binary.hh"
+
+TEST(WagnerBinary, SnapshotsConvertToTheSameXml) {
+  auto rng = std::mt19937_64{42};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(64, 0.25, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 5)};
+  (*tree.begin())->add_to(0);
+  for (auto i = 0; i < 20; ++i) {
+    auto parent = *tree.begin();
+    tree.speciate(parent, 1)->add_to(landscape.random_vertex(rng));
+  }
+  for (auto sp : tree) {
+    for (auto i = 0; i < 3; ++i) sp->add_to(landscape.random_vertex(rng));
+    sp->up_groups(landscape);
+  }
+
+  wagner::snapshot s;
+  s.capture(tree, 16);
+  std::ostringstream xml;
+  s.write(xml, landscape);
+
+  const char *name = "w-binary-spec.bin";
+  {
+    std::ofstream out(name, std::ios::binary);
+    s.write_binary(out, landscape);
+  }
+  {
+    wagner::binary_snapshot_reader reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(16u, reader.t());
+    EXPECT_EQ(tree.num_species(), reader.num_species());
+    EXPECT_EQ(5u, reader.num_traits());
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(reader.traits()) % 8);
+    std::ostringstream converted;
+    reader.write_xml(converted, landscape.values());
+    EXPECT_EQ(xml.str(), converted.str());
+  }
+  std::remove(name);
+}
+
+TEST(WagnerBinary, RunsConvertToTheSameXml) {
+  auto rng = std::mt19937_64{7};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(32, 0.3, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 3)};
+  (*tree.begin())->add_to(0);
+
+  wagner::run_info const info{wagner::model::euclidean_traits, 2, 1, 7, 8, 32, 0.3, 1, 3,
+                              0.005f, wagner::sampler::direct, wagner::boundary::reflect,
+                              wagner::schedule::synchronous,
+                              wagner::migration_draws::per_target,                               10.0, 0.04, 0.04, 0.05};
+  std::vector<size_t> speciation, extinctions, species;
+
+  std::ostringstream xml;
+  wagner::write_xml_header(xml, info);
+  const char *name = "w-binary-spec-run.bin";
+  wagner::binary_run_writer writer;
+  writer.open(name, info, landscape.values());
+  for (size_t t = 1; t <= 8; ++t) {
+    auto parent = *tree.begin();
+    tree.speciate(parent, t)->add_to(landscape.random_vertex(rng));
+    speciation.push_back(t);
+    extinctions.push_back(t % 3);
+    species.push_back(tree.num_species());
+    if (t == 1 || t == 2 || t == 4 || t == 8) {
+      tree.stop(t);
+      xml << "   <newick><t>" << t << "</t>" << tree << "</newick>\n";
+      writer.tree(t, tree);
+    }
+  }
+  wagner::write_xml_footer(xml, speciation.data(), extinctions.data(), species.data(),
+                           species.size());
+  writer.close(speciation.data(), extinctions.data(), species.data(), species.size());
+
+  {
+    wagner::binary_run_reader reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(4u, reader.num_trees());
+    EXPECT_EQ(8u, reader.num_steps());
+    auto const positions = reader.positions();
+    ASSERT_EQ(landscape.values().size(), positions.size());
+    for (size_t v = 0; v < positions.size(); ++v) {
+      EXPECT_EQ(landscape.value(v).x, positions[v].x);
+      EXPECT_EQ(landscape.value(v).y, positions[v].y);
+    }
+    std::ostringstream converted;
+    reader.write_xml(converted);
+    EXPECT_EQ(xml.str(), converted.str());
+  }
+  std::remove(name);
+}
+
+TEST(WagnerBinary, OtherFilesAreRejected) {
+  const char *name = "w-binary-spec-bad.bin";
+  {
+    std::ofstream out(name);
+    out << "<wagner>\n   <version>2</version>\n   <revision>1</revision>\n</wagner>\n";
+  }
+  wagner::binary_run_reader run;
+  EXPECT_FALSE(run.open(name));
+  wagner::binary_snapshot_reader species;
+  EXPECT_FALSE(species.open(name));
+  EXPECT_FALSE(species.open("w-binary-spec-missing.bin"));
+  std::remove(name);
+}
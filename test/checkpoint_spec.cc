@@ -0,0 +1,255 @@
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "gtest/gtest.h"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/output.hh"
+#include "wagner/checkpoint.hh"
+#include "wagner/simulation.hh"
+
+static auto read_file(const char *path) -> std::string {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream content;
+  content << in.rdbuf();
+  return content.str();
+}
+
+// 'bytes' with the value at 'offset' replaced by 'value'.
+template<typename T>
+static auto patched(std::string bytes, size_t offset, T value) -> std::string {
+  std::memcpy(&bytes[offset], &value, sizeof(value));
+  return bytes;
+}
+
+// Remove the files of the run of seed 'seed'.
+static auto remove_run(size_t seed) -> void {
+  auto const name = "w-" + std::to_string(seed);
+  for (auto suffix : {".xml", ".bin", ".ckpt"}) {
+    std::remove((name + suffix).c_str());
+  }
+  std::remove(("w-network-" + std::to_string(seed) + ".graphml").c_str());
+  for (size_t t = 1; t <= 32; t *= 2) {
+    auto const species = "w-species-" + std::to_string(seed) + "-t" + std::to_string(t);
+    std::remove((species + ".xml").c_str());
+    std::remove((species + ".bin").c_str());
+  }
+}
+
+TEST(WagnerCheckpoint, TreesAndLandscapesAreRestored) {
+  auto rng = std::mt19937_64{5};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(48, 0.25, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 4)};
+  (*tree.begin())->add_to(0);
+  for (size_t t = 1; t <= 12; ++t) {
+    std::vector<wagner::species*> tips(tree.begin(), tree.end());
+    auto parent = tips[rng() % tips.size()];
+    tree.speciate(parent, t)->add_to(landscape.random_vertex(rng));
+    parent->add_to(landscape.random_vertex(rng));
+    if (t % 4 == 0) {
+      // Frees a slot.
+      auto dead = tips[rng() % tips.size()];
+      for (auto v : std::vector<wagner::vertex>(dead->get_locations().begin(),
+                                                dead->get_locations().end())) {
+        dead->rmv_from(v);
+      }
+      tree.rmv_extinct(t);
+    }
+  }
+  tree.stop(12);
+
+  wagner::run_info const info{wagner::model::fuzzy_traits, 2, 1, 5, 16, 48, 0.25, 3, 4,
+                              0.005f, wagner::sampler::direct, wagner::boundary::project,
+                              wagner::schedule::synchronous,
+                              wagner::migration_draws::per_target, 10.0, 0.04, 0.04, 0.05};
+  std::vector<size_t> speciation{1, 0, 2}, extinctions{0, 1, 1}, species{2, 2, 3};
+  wagner::checkpoint_progress progress{wagner::output_format::both, 3, 8, 3, 17,
+                                       123, 456, 2, "engine state"};
+  const char *name = "w-checkpoint-spec.ckpt";
+  ASSERT_TRUE(wagner::write_checkpoint(name, info, progress, landscape, tree,
+                                       speciation.data(), extinctions.data(), species.data()));
+
+  wagner::checkpoint_reader reader;
+  ASSERT_TRUE(reader.open(name));
+  auto const read_info = reader.info();
+  EXPECT_EQ(info.m, read_info.m);
+  EXPECT_EQ(info.draws, read_info.draws);
+  EXPECT_EQ(info.white_noise_std, read_info.white_noise_std);
+  auto const read_progress = reader.progress();
+  EXPECT_EQ(progress.format, read_progress.format);
+  EXPECT_EQ(3u, read_progress.t);
+  EXPECT_EQ(17u, read_progress.populations);
+  EXPECT_EQ(456u, read_progress.bin_size);
+  EXPECT_EQ(progress.engines, read_progress.engines);
+  for (size_t t = 0; t < 3; ++t) {
+    EXPECT_EQ(speciation[t], reader.speciation_per_t()[t]);
+    EXPECT_EQ(extinctions[t], reader.extinctions_per_t()[t]);
+    EXPECT_EQ(species[t], reader.species_per_t()[t]);
+  }
+
+  auto const restored_landscape = reader.landscape();
+  ASSERT_EQ(landscape.order(), restored_landscape.order());
+  EXPECT_EQ(landscape.offsets(), restored_landscape.offsets());
+  EXPECT_EQ(landscape.adjacency(), restored_landscape.adjacency());
+  for (wagner::vertex v = 0; v < landscape.order(); ++v) {
+    EXPECT_EQ(landscape.value(v).x, restored_landscape.value(v).x);
+    EXPECT_EQ(landscape.value(v).y, restored_landscape.value(v).y);
+  }
+
+  wagner::speciestree restored{reader.tree()};
+  EXPECT_EQ(tree.newick(), restored.newick());
+  EXPECT_EQ(tree.id_count(), restored.id_count());
+  EXPECT_EQ(tree.num_slots(), restored.num_slots());
+  EXPECT_EQ(tree.free_slots(), restored.free_slots());
+  ASSERT_EQ(tree.num_species(), restored.num_species());
+  std::vector<wagner::species*> before(tree.begin(), tree.end());
+  std::vector<wagner::species*> after(restored.begin(), restored.end());
+  for (size_t i = 0; i < before.size(); ++i) {
+    EXPECT_EQ(before[i]->id, after[i]->id);
+    EXPECT_EQ(before[i]->slot(), after[i]->slot());
+    EXPECT_TRUE(before[i]->same_traits_as(*after[i]));
+    EXPECT_TRUE(std::equal(before[i]->get_locations().begin(), before[i]->get_locations().end(),
+                           after[i]->get_locations().begin(), after[i]->get_locations().end()));
+    EXPECT_EQ(before[i]->up_groups(landscape), after[i]->up_groups(landscape));
+  }
+  for (wagner::vertex v = 0; v < landscape.order(); ++v) {
+    EXPECT_EQ(tree.residents(v).size(), restored.residents(v).size());
+  }
+  EXPECT_EQ(tree.mrca(*before.front(), *before.back()),
+            restored.mrca(*after.front(), *after.back()));
+  std::remove(name);
+}
+
+TEST(WagnerCheckpoint, DamagedCheckpointsAreNotRead) {
+  auto rng = std::mt19937_64{9};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(16, 0.5, rng);
+  ASSERT_LT(0u, landscape.size());
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 2)};
+  (*tree.begin())->add_to(0);
+  tree.speciate(*tree.begin(), 1)->add_to(1);
+
+  wagner::run_info const info{wagner::model::neutral, 2, 1, 9, 16, 16, 0.5, 1, 2,
+                              0.005f, wagner::sampler::rejection, wagner::boundary::rejection,
+                              wagner::schedule::sequential,
+                              wagner::migration_draws::per_trial, 10.0, 0.04, 0.04, 0.05};
+  std::vector<size_t> per_t{1, 2};
+  wagner::checkpoint_progress progress{wagner::output_format::xml, 0, 1, 2, 2, 0, 0, 0,
+                                       "engine state"};
+  const char *name = "w-checkpoint-damaged.ckpt";
+  ASSERT_TRUE(wagner::write_checkpoint(name, info, progress, landscape, tree,
+                                       per_t.data(), per_t.data(), per_t.data()));
+  auto const bytes = read_file(name);
+  wagner::checkpoint_header h;
+  {
+    wagner::checkpoint_reader reader;
+    ASSERT_TRUE(reader.open(name));
+    h = reader.header();
+  }
+  wagner::checkpoint_layout const layout(h);
+  // The nodes in preorder: the root, then its two species.
+  ASSERT_EQ(3u, h.num_nodes);
+
+  auto const damaged = std::vector<std::string>{
+    bytes.substr(0, layout.size - 8),
+    patched(bytes, offsetof(wagner::checkpoint_header, model), int32_t{7}),
+    patched(bytes, offsetof(wagner::checkpoint_header, num_nodes), uint64_t{1} << 60),
+    patched(bytes, layout.offsets, uint32_t{1}),
+    patched(bytes, layout.adjacency, static_cast<uint32_t>(h.num_vertices)),
+    // One species short, or a species where the root should be.
+    patched(bytes, layout.leaves + 2, uint8_t{0}),
+    patched(patched(bytes, layout.leaves, uint8_t{1}), layout.leaves + 2, uint8_t{0}),
+    patched(bytes, layout.ids + 8, uint64_t{h.id_count}),
+    patched(bytes, layout.slots + 8, uint64_t{h.num_slots}),
+    patched(bytes, layout.slots + 8, uint64_t{0}),
+    patched(bytes, layout.first_location + 8, uint64_t{h.num_locations + 1}),
+    patched(bytes, layout.locations, static_cast<uint32_t>(h.num_vertices))};
+  for (auto const& content : damaged) {
+    std::ofstream(name, std::ios::binary) << content;
+    wagner::checkpoint_reader reader;
+    EXPECT_FALSE(reader.open(name));
+    EXPECT_FALSE(wagner::resume(name));
+  }
+  std::remove(name);
+}
+
+TEST(WagnerCheckpoint, ResumedRunsGoOnAsIfTheyHadNotStopped) {
+  auto run = [](size_t interval) {
+    wagner::simulation(wagner::model::euclidean_traits, 25, 32, 40, 4, 0.05, 0.1, 10.0,
+                       0.05, 0.3, 0.005f, wagner::sampler::rejection,
+                       wagner::boundary::rejection, wagner::output_format::xml, 0,
+                       wagner::migration_draws::per_trial, interval);
+  };
+  run(0);
+  auto const expected = read_file("w-25.xml");
+  ASSERT_NE(std::string::npos, expected.find("<t>32</t>"));
+
+  // The last checkpoint is taken after 30 time steps, before the tree of t = 32.
+  run(10);
+  {
+    std::ofstream out("w-25.xml", std::ios::app);
+    out << "Written after the checkpoint.\n";
+  }
+  ASSERT_TRUE(wagner::resume("w-25.ckpt"));
+  EXPECT_EQ(expected, read_file("w-25.xml"));
+  EXPECT_FALSE(wagner::resume("w-checkpoint-spec-missing.ckpt"));
+  remove_run(25);
+}
+
+TEST(WagnerCheckpoint, ResumedRunsKeepTheBinaryFilesAndTheSynchronousSchedule) {
+  auto run = [](size_t interval) {
+    wagner::simulation(wagner::model::phylo_dist, 26, 32, 40, 4, 0.05, 0.1, 10.0,
+                       0.05, 0.3, 0.005f, wagner::sampler::rejection,
+                       wagner::boundary::rejection, wagner::output_format::both, 2,
+                       wagner::migration_draws::per_target, interval);
+  };
+  run(0);
+  auto const expected_xml = read_file("w-26.xml");
+  auto const expected_bin = read_file("w-26.bin");
+  auto const expected_species = read_file("w-species-26-t32.bin");
+  ASSERT_NE(std::string::npos, expected_xml.find("<t>32</t>"));
+
+  run(10);
+  for (auto name : {"w-26.xml", "w-26.bin"}) {
+    std::ofstream out(name, std::ios::app | std::ios::binary);
+    out << "Written after the checkpoint.\n";
+  }
+  std::remove("w-species-26-t32.bin");
+  // The philox streams do not depend on the number of threads.
+  ASSERT_TRUE(wagner::resume("w-26.ckpt", 3));
+  EXPECT_EQ(expected_xml, read_file("w-26.xml"));
+  EXPECT_EQ(expected_bin, read_file("w-26.bin"));
+  EXPECT_EQ(expected_species, read_file("w-species-26-t32.bin"));
+  remove_run(26);
+}
+
+TEST(WagnerCheckpoint, RunsWithoutTheirOutputFilesAreNotResumed) {
+  wagner::simulation(wagner::model::neutral, 27, 32, 40, 4, 0.05, 0.1, 10.0, 0.05, 0.3,
+                     0.005f, wagner::sampler::rejection, wagner::boundary::rejection,
+                     wagner::output_format::both, 0, wagner::migration_draws::per_trial, 10);
+  auto const checkpoint = read_file("w-27.ckpt");
+  auto const xml = read_file("w-27.xml");
+  ASSERT_FALSE(checkpoint.empty());
+
+  std::remove("w-27.xml");
+  EXPECT_FALSE(wagner::resume("w-27.ckpt", 0, 2));
+  // Shorter than when the checkpoint was taken:
+  std::ofstream("w-27.xml").close();
+  EXPECT_FALSE(wagner::resume("w-27.ckpt", 0, 2));
+  std::ofstream("w-27.xml") << xml;
+  std::remove("w-27.bin");
+  EXPECT_FALSE(wagner::resume("w-27.ckpt", 0, 2));
+  // No checkpoint was written over the one of the run.
+  EXPECT_EQ(checkpoint, read_file("w-27.ckpt"));
+  remove_run(27);
+}
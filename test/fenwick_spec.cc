@@ -0,0 +1,30 @@
+#include <vector>
+#include <random>
+#include "gtest/gtest.h"
+#include "wagner/fenwick.hh"
+
+TEST(WagnerFenwick, DrawsMatchLinearWalk) {
+  auto rng = std::mt19937_64{42};
+  auto ws = std::vector<long>(37);
+  for (auto &w : ws) w = rng() % 4; // Some weights are 0.
+  auto f = wagner::fenwick<long>(ws);
+  for (auto step = 0; step < 200; ++step) {
+    auto const i = rng() % ws.size();
+    auto const delta = ws[i] > 0 && rng() % 2 ? -1l : 1l;
+    ws[i] += delta;
+    f.add(i, delta);
+
+    auto total = 0l;
+    for (size_t j = 0; j < ws.size(); ++j) {
+      EXPECT_EQ(total, f.prefix(j));
+      total += ws[j];
+    }
+    ASSERT_EQ(total, f.total());
+    for (auto x = 0l; x < total; ++x) {
+      size_t j = 0;
+      auto rest = x;
+      for (; rest >= ws[j]; ++j) rest -= ws[j];
+      EXPECT_EQ(std::make_pair(j, rest), f.find(x));
+    }
+  }
+}
@@ -0,0 +1,140 @@
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "gtest/gtest.h"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/migration.hh"
+#include "wagner/model.hh"
+
+namespace {
+
+// The locations of all the species, in the order of the tree.
+auto locations(wagner::speciestree &tree) -> std::vector<std::vector<wagner::vertex>> {
+  std::vector<std::vector<wagner::vertex>> ls;
+  for (auto sp : tree) {
+    ls.emplace_back(sp->get_locations().begin(), sp->get_locations().end());
+    std::sort(ls.back().begin(), ls.back().end());
+  }
+  return ls;
+}
+
+// A few steps of synchronous migration on 'threads' threads, from the same
+// landscape and species.
+template<wagner::model m>
+auto migrate(size_t threads, size_t &new_pops,
+             size_t &old_pops) -> std::vector<std::vector<wagner::vertex>> {
+  auto rng = std::mt19937_64{42};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(256, 0.12, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 4)};
+  std::vector<wagner::species*> tips(tree.begin(), tree.end());
+  while (tips.size() < 40) {
+    tips.push_back(tree.speciate(tips[rng() % tips.size()], tips.size()));
+  }
+  for (auto sp : tips) {
+    for (auto i = 0; i < 4; ++i) sp->add_to(landscape.random_vertex(rng));
+  }
+  tree.update_distances();
+  old_pops = 0;
+  for (auto sp : tips) old_pops += sp->size();
+
+  wagner::synchronous_migration phase(threads, 42);
+  new_pops = 0;
+  for (size_t t = 100; t < 105; ++t) {
+    new_pops += phase.run<m>(tree, landscape, t, 0.3, 1.0);
+  }
+  return locations(tree);
+}
+
+}
+
+TEST(WagnerMigration, SynchronousResultsDoNotDependOnTheThreads) {
+  size_t n1, n3, n8, old;
+  auto const l1 = migrate<wagner::model::euclidean_traits>(1, n1, old);
+  auto const l3 = migrate<wagner::model::euclidean_traits>(3, n3, old);
+  auto const l8 = migrate<wagner::model::euclidean_traits>(8, n8, old);
+  EXPECT_GT(n1, 0u);
+  EXPECT_EQ(n1, n3);
+  EXPECT_EQ(n1, n8);
+  EXPECT_EQ(l1, l3);
+  EXPECT_EQ(l1, l8);
+
+  auto const p1 = migrate<wagner::model::phylo_dist>(1, n1, old);
+  auto const p8 = migrate<wagner::model::phylo_dist>(8, n8, old);
+  EXPECT_EQ(n1, n8);
+  EXPECT_EQ(p1, p8);
+}
+
+TEST(WagnerMigration, SynchronousNewPopulationsAreCounted) {
+  size_t new_pops, old_pops;
+  auto const after = migrate<wagner::model::neutral>(2, new_pops, old_pops);
+  size_t total = 0;
+  for (auto const& l : after) total += l.size();
+  EXPECT_GT(new_pops, 0u);
+  EXPECT_EQ(old_pops + new_pops, total);
+}
+
+namespace {
+
+// How often species 0 founds a population on each vertex in one migration
+// phase, over 'reps' phases from the same state: species 0 on three vertices,
+// a copy of it (its competitor) on three others.
+auto frequencies(wagner::migration_draws draws, size_t reps, std::vector<size_t> &trials,
+                 std::vector<double> &rates) -> std::vector<double> {
+  auto rng = std::mt19937_64{1};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(48, 0.25, rng);
+  wagner::vertex const mine[] = {0, 1, 2}, theirs[] = {3, 4, 5};
+  double const mig_max = 0.3, aleph = 1.0;
+
+  std::vector<double> freq(landscape.order(), 0.0);
+  for (size_t k = 0; k < reps; ++k) {
+    wagner::speciestree tree{std::vector<float>{0.1f, 0.2f}};
+    auto s0 = *tree.begin();
+    auto s1 = tree.speciate(s0, 1);
+    for (auto v : mine) s0->add_to(v);
+    for (auto v : theirs) s1->add_to(v);
+    tree.update_distances();
+    wagner::migration<wagner::model::euclidean_traits>(tree, landscape, 2, mig_max, aleph, rng, draws);
+    for (wagner::vertex v = 0; v < landscape.order(); ++v) {
+      if (s0->is_in(v)) freq[v] += 1.0 / reps;
+    }
+  }
+
+  // Trials of species 0 on each vertex, and their rates.
+  trials.assign(landscape.order(), 0);
+  rates.assign(landscape.order(), mig_max);
+  for (auto v : mine) {
+    for (auto w : landscape.neighbors(v)) ++trials[w];
+  }
+  for (auto v : theirs) rates[v] = mig_max * std::exp(-aleph);
+  for (auto v : mine) trials[v] = 0;
+  return freq;
+}
+
+}
+
+TEST(WagnerMigration, DrawsPerTargetKeepTheDistribution) {
+  size_t const reps = 20000;
+  for (auto draws : {wagner::migration_draws::per_trial, wagner::migration_draws::per_target}) {
+    std::vector<size_t> trials;
+    std::vector<double> rates;
+    auto const freq = frequencies(draws, reps, trials, rates);
+    size_t targets = 0;
+    for (size_t v = 0; v < freq.size(); ++v) {
+      if (trials[v] == 0) {
+        continue;
+      }
+      ++targets;
+      double const p = 1.0 - std::pow(1.0 - rates[v], trials[v]);
+      double const sigma = std::sqrt(p * (1.0 - p) / reps);
+      EXPECT_NEAR(p, freq[v], 5.0 * sigma) << draws << ", vertex " << v << ", " << trials[v] << " trials";
+    }
+    EXPECT_GT(targets, 3u);
+  }
+}
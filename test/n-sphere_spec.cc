@@ -10,3 +10,50 @@ TEST(WagnerNSphere, DistancesBetweenRandomSpheresBelow1) {
     EXPECT_TRUE(wagner::euclidean_distance(x, y) <= 1.0);
   }
 }
+
+TEST(WagnerNSphere, DirectSamplerIsUniformInTheBall) {
+  auto rng = std::mt19937_64{42};
+  for (size_t n : {1, 2, 10, 64}) {
+    // Half the volume of the ball lies within radius * 0.5^(1/n).
+    auto const half = 0.5f * std::pow(0.5f, 1.0f / n);
+    auto inner = 0;
+    auto mean = std::vector<double>(n, 0.0);
+    for (auto i = 0; i < 4000; ++i) {
+      auto const x = wagner::random_n_sphere<float>(rng, n, 0.5f, wagner::sampler::direct);
+      ASSERT_EQ(n, x.size());
+      EXPECT_TRUE(wagner::in_sphere(x, 0.5f));
+      if (wagner::simd::squared_norm(x.data(), n) < half * half) ++inner;
+      for (size_t j = 0; j < n; ++j) mean[j] += x[j] / 4000.0;
+    }
+    EXPECT_NEAR(2000, inner, 200);
+    for (auto m : mean) EXPECT_NEAR(0.0, m, 0.05);
+  }
+}
+
+TEST(WagnerNSphere, BoundedWhiteNoiseStaysInTheSphere) {
+  for (auto b : {wagner::boundary::reflect, wagner::boundary::project}) {
+    auto rng = std::mt19937_64{42}, ref = std::mt19937_64{42};
+    auto d = std::normal_distribution<float>{0.0f, 0.2f}, dref = d;
+    auto xs = std::vector<float>(16, 0.1f);
+    for (auto i = 0; i < 1000; ++i) {
+      wagner::white_noise(xs, rng, d, 0.5f, b);
+      EXPECT_TRUE(wagner::in_sphere(xs, 0.5f));
+      // Exactly one draw per trait.
+      for (size_t j = 0; j < xs.size(); ++j) dref(ref);
+      EXPECT_EQ(rng, ref);
+    }
+  }
+}
+
+TEST(WagnerNSphere, ReflectedWhiteNoiseIsUniformInTheLongRun) {
+  // In two dimensions, half the disk lies within radius / sqrt(2).
+  auto rng = std::mt19937_64{7};
+  auto d = std::normal_distribution<float>{0.0f, 0.05f};
+  auto xs = std::vector<float>{0.0f, 0.0f};
+  auto inner = 0;
+  for (auto i = 0; i < 200000; ++i) {
+    wagner::white_noise(xs, rng, d, 0.5f, wagner::boundary::reflect);
+    if (wagner::squared_norm(xs.data(), 2) < 0.125f) ++inner;
+  }
+  EXPECT_NEAR(0.5, inner / 200000.0, 0.05);
+}
@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+
+TEST(WagnerNetwork, CompressedRowsFromEdges) {
+  auto const vs = std::vector<int>{10, 11, 12, 13};
+  auto const es = std::vector<std::pair<wagner::vertex, wagner::vertex>>{
+    {2, 0}, {0, 2}, {0, 1}, {1, 0}, {3, 0}
+  };
+  auto const net = wagner::network<int>(vs, es);
+  EXPECT_EQ(4u, net.order());
+  EXPECT_EQ(5u, net.size());
+  EXPECT_EQ(2u, net.size(0));
+  EXPECT_EQ(1u, net.size(3));
+  EXPECT_EQ(12, net.value(2));
+  EXPECT_TRUE(net.has_edge(3, 0));
+  EXPECT_FALSE(net.has_edge(0, 3));
+  auto const ns = net.neighbors(0);
+  EXPECT_EQ((std::vector<wagner::vertex>{1, 2}), std::vector<wagner::vertex>(ns.begin(), ns.end()));
+  EXPECT_FALSE(net.connected());
+}
+
+TEST(WagnerNetwork, StrongConnectivityFollowsTheDirectionOfTheEdges) {
+  auto const vs = std::vector<int>{0, 1, 2};
+  // Every vertex is reached from 0, but 0 is reached from no other vertex:
+  auto const chain = wagner::network<int>(vs, {{0, 1}, {1, 2}});
+  EXPECT_FALSE(chain.connected());
+  auto const cycle = wagner::network<int>(vs, {{0, 1}, {1, 2}, {2, 0}});
+  EXPECT_TRUE(cycle.connected());
+}
+
+TEST(WagnerNetwork, RandomGeometricGraph) {
+  auto rng = std::mt19937_64{42};
+  auto net = wagner::network<wagner::point>{};
+  net.rgg(200, 0.2, rng);
+  EXPECT_EQ(200u, net.order());
+  for (wagner::vertex v = 0; v < net.order(); ++v) {
+    if (v > 0) {
+      EXPECT_TRUE(net.value(v - 1) < net.value(v));
+    }
+    for (wagner::vertex u = 0; u < net.order(); ++u) {
+      auto const close = u != v && euclidean_distance(net.value(u), net.value(v)) < 0.2;
+      EXPECT_EQ(close, net.has_edge(v, u));
+    }
+  }
+}
+
+TEST(WagnerNetwork, RandomGeometricGraphsWithoutRadiusHaveNoEdges) {
+  auto rng = std::mt19937_64{42};
+  for (auto radius : {0.0, 1e-30, -0.5}) {
+    auto net = wagner::network<wagner::point>{};
+    net.rgg(50, radius, rng);
+    EXPECT_EQ(50u, net.order());
+    EXPECT_EQ(0u, net.size());
+  }
+}
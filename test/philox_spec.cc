@@ -0,0 +1,77 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "wagner/philox.hh"
+
+TEST(WagnerPhilox, MatchesTheReferenceBlocks) {
+  // Known-answer tests of the Random123 distribution.
+  uint64_t out[4];
+  {
+    uint64_t const ctr[4] = {0, 0, 0, 0};
+    uint64_t const key[2] = {0, 0};
+    wagner::philox::block(ctr, key, out);
+    EXPECT_EQ(0x16554d9eca36314cull, out[0]);
+    EXPECT_EQ(0xdb20fe9d672d0fdcull, out[1]);
+    EXPECT_EQ(0xd7e772cee186176bull, out[2]);
+    EXPECT_EQ(0x7e68b68aec7ba23bull, out[3]);
+  }
+  {
+    uint64_t const ctr[4] = {~0ull, ~0ull, ~0ull, ~0ull};
+    uint64_t const key[2] = {~0ull, ~0ull};
+    wagner::philox::block(ctr, key, out);
+    EXPECT_EQ(0x87b092c3013fe90bull, out[0]);
+    EXPECT_EQ(0x438c3c67be8d0224ull, out[1]);
+    EXPECT_EQ(0x9cc7d7c69cd777b6ull, out[2]);
+    EXPECT_EQ(0xa09caebf594f0ba0ull, out[3]);
+  }
+  {
+    uint64_t const ctr[4] = {0x243f6a8885a308d3ull, 0x13198a2e03707344ull,
+                             0xa4093822299f31d0ull, 0x082efa98ec4e6c89ull};
+    uint64_t const key[2] = {0x452821e638d01377ull, 0xbe5466cf34e90c6cull};
+    wagner::philox::block(ctr, key, out);
+    EXPECT_EQ(0xa528f45403e61d95ull, out[0]);
+    EXPECT_EQ(0x38c72dbd566e9788ull, out[1]);
+    EXPECT_EQ(0xa5a1610e72fd18b5ull, out[2]);
+    EXPECT_EQ(0x57bd43b5e52b7fe6ull, out[3]);
+  }
+}
+
+TEST(WagnerPhilox, StreamsAreTheBlocksOfTheirCounters) {
+  wagner::philox rng(7, 1, 3, 5, 11);
+  uint64_t const key[2] = {7, 1};
+  for (uint64_t b = 0; b < 5; ++b) {
+    uint64_t const ctr[4] = {3, 5, 11, b};
+    uint64_t out[4];
+    wagner::philox::block(ctr, key, out);
+    for (auto x : out) EXPECT_EQ(x, rng());
+  }
+}
+
+TEST(WagnerPhilox, DiscardSkipsOutputs) {
+  wagner::philox ref(1, 2, 3);
+  std::vector<uint64_t> xs(64);
+  for (auto &x : xs) x = ref();
+  for (size_t first = 0; first < 8; ++first) {
+    for (size_t n = 0; n < 40; ++n) {
+      wagner::philox rng(1, 2, 3);
+      for (size_t i = 0; i < first; ++i) rng();
+      rng.discard(n);
+      EXPECT_EQ(xs[first + n], rng());
+    }
+  }
+}
+
+TEST(WagnerPhilox, WorksWithTheDistributions) {
+  // Close streams are unrelated: the means of neighboring streams are those
+  // of independent uniform draws.
+  std::uniform_real_distribution<> unif;
+  double sum = 0.0;
+  size_t const streams = 1000, draws = 100;
+  for (uint64_t s = 0; s < streams; ++s) {
+    wagner::philox rng(42, 0, 0, s);
+    for (size_t i = 0; i < draws; ++i) sum += unif(rng);
+  }
+  // Standard deviation of the mean: 1 / sqrt(12 * 1e5) < 0.001.
+  EXPECT_NEAR(0.5, sum / (streams * draws), 0.005);
+}
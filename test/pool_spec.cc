@@ -0,0 +1,35 @@
+#include <vector>
+#include "gtest/gtest.h"
+#include "wagner/pool.hh"
+
+namespace {
+
+struct counted {
+  static int alive;
+  int value;
+  explicit counted(int v) : value(v) { ++alive; }
+  ~counted() { --alive; }
+};
+
+int counted::alive = 0;
+
+}
+
+TEST(WagnerPool, ReusesSlotsAndDestroysTheRest) {
+  {
+    wagner::pool<counted, 4> p;
+    std::vector<counted*> cs;
+    for (int i = 0; i < 10; ++i) cs.push_back(p.create(i));
+    EXPECT_EQ(10, counted::alive);
+    EXPECT_EQ(10u, p.size());
+    for (int i = 0; i < 10; ++i) EXPECT_EQ(i, cs[i]->value);
+
+    p.destroy(cs[3]);
+    p.destroy(cs[8]);
+    EXPECT_EQ(8, counted::alive);
+    auto const c = p.create(42);
+    EXPECT_EQ(cs[8], c); // Last destroyed, first reused.
+    EXPECT_EQ(9u, p.size());
+  }
+  EXPECT_EQ(0, counted::alive);
+}
@@ -0,0 +1,50 @@
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "gtest/gtest.h"
+#include "wagner/range.hh"
+
+template<typename R>
+class WagnerRange : public ::testing::Test {};
+
+using range_types = ::testing::Types<wagner::map_range, wagner::bitset_range>;
+TYPED_TEST_CASE(WagnerRange, range_types);
+
+TYPED_TEST(WagnerRange, BehavesLikeASortedSet) {
+  auto rng = std::mt19937_64{42};
+  auto r0 = TypeParam{}, r1 = TypeParam{};
+  auto s0 = std::vector<wagner::vertex>{}, s1 = std::vector<wagner::vertex>{};
+  for (auto i = 0; i < 500; ++i) {
+    auto const v = (wagner::vertex)(rng() % 1000), u = (wagner::vertex)(rng() % 1000);
+    r0.insert(v);
+    s0.push_back(v);
+    r1.insert(u);
+    s1.push_back(u);
+    if (i % 3 == 0) {
+      auto const w = s0[rng() % s0.size()];
+      r0.erase(w);
+      s0.erase(std::remove(s0.begin(), s0.end(), w), s0.end());
+    }
+  }
+  for (auto s : {&s0, &s1}) {
+    std::sort(s->begin(), s->end());
+    s->erase(std::unique(s->begin(), s->end()), s->end());
+  }
+  EXPECT_EQ(s0.size(), r0.size());
+  EXPECT_EQ(s0, std::vector<wagner::vertex>(r0.begin(), r0.end()));
+  for (size_t i = 0; i < s0.size(); ++i) {
+    EXPECT_EQ(s0[i], r0.nth(i));
+  }
+  for (wagner::vertex v = 0; v < 1100; ++v) {
+    EXPECT_EQ(std::binary_search(s0.begin(), s0.end(), v), r0.contains(v));
+  }
+
+  auto common = std::vector<wagner::vertex>{};
+  std::set_intersection(s0.begin(), s0.end(), s1.begin(), s1.end(), std::back_inserter(common));
+  EXPECT_EQ(common, r0 & r1);
+  EXPECT_EQ(common.size(), r0.common(r1));
+
+  r0.set_label(s0.front(), 7);
+  EXPECT_EQ(7, r0.label(s0.front()));
+  EXPECT_EQ(-1, r0.label(s0.back()));
+}
@@ -0,0 +1,90 @@
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include "gtest/gtest.h"
+#include "wagner/simd.hh"
+#include "wagner/n-sphere.hh"
+
+TEST(WagnerSimd, MatchesTheScalarSums) {
+  auto rng = std::mt19937_64{42};
+  auto unif = std::uniform_real_distribution<float>{-0.5f, 0.5f};
+  for (size_t n = 0; n <= 300; ++n) {
+    auto xs = std::vector<float>(n), ys = std::vector<float>(n);
+    for (size_t i = 0; i < n; ++i) {
+      xs[i] = unif(rng);
+      ys[i] = unif(rng);
+    }
+    double dist = 0.0, norm = 0.0;
+    float ordered = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+      dist += (double(xs[i]) - ys[i]) * (double(xs[i]) - ys[i]);
+      norm += double(xs[i]) * xs[i];
+      ordered += xs[i] * xs[i];
+    }
+    EXPECT_NEAR(dist, wagner::simd::squared_distance(xs.data(), ys.data(), n), 1e-5 * (1 + dist));
+    EXPECT_NEAR(norm, wagner::simd::squared_norm(xs.data(), n), 1e-5 * (1 + norm));
+    // in_sphere adds the squares in order (see n-sphere.hh).
+    EXPECT_EQ(ordered < 0.25f, wagner::in_sphere(xs, 0.5f));
+  }
+}
+
+TEST(WagnerSimd, BatchedDistancesMatchPairwise) {
+  auto rng = std::mt19937_64{7};
+  auto unif = std::uniform_real_distribution<float>{-0.5f, 0.5f};
+  for (size_t n : {2, 5, 16, 33, 256}) {
+    size_t const stride = (n + 15) / 16 * 16, rows = 40;
+    auto base = std::vector<float>(rows * stride, 0.0f);
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t i = 0; i < n; ++i) base[r * stride + i] = unif(rng);
+    }
+    auto const picks = std::vector<size_t>{3, 0, 39, 17, 17, 8};
+    auto out = std::vector<float>(picks.size());
+    // Zero padding does not change the distances, whole strides or not.
+    for (auto len : {n, stride}) {
+      wagner::simd::distances(&base[5 * stride], base.data(), stride,
+                              picks.data(), picks.size(), len, out.data());
+      for (size_t k = 0; k < picks.size(); ++k) {
+        EXPECT_EQ(wagner::euclidean_distance(&base[5 * stride], &base[picks[k] * stride], n),
+                  out[k]);
+      }
+    }
+  }
+}
+
+namespace {
+
+// Replays given outputs, as a 64-bit engine.
+struct replay {
+  using result_type = uint64_t;
+  const uint64_t *xs;
+  static constexpr auto min() -> result_type { return 0; }
+  static constexpr auto max() -> result_type { return ~result_type(0); }
+  auto operator()() -> result_type { return *xs++; }
+};
+
+}
+
+TEST(WagnerSimd, UniformsMatchTheStandardDistribution) {
+  auto rng = std::mt19937_64{11};
+  auto xs = std::vector<uint64_t>(1000);
+  for (auto &x : xs) x = rng();
+  // Edges: zero, the top (rounded to 1), and halfway cases of the rounding.
+  uint64_t const edges[] = {0, 1, ~0ull, ~0ull - 1023, ~0ull - 1024, ~0ull - 2048,
+                            (1ull << 53) + 1, (1ull << 54) + 2, (1ull << 54) + 6,
+                            (1ull << 63) + 1024, (1ull << 63) + 3072, 0xFFFFFFFFull,
+                            0x100000000ull, 0x8000000000000400ull};
+  xs.insert(xs.end(), std::begin(edges), std::end(edges));
+  for (size_t n : {xs.size(), size_t(1), size_t(3), size_t(13)}) {
+    auto us = std::vector<double>(n);
+    wagner::simd::uniforms(xs.data() + xs.size() - n, n, us.data());
+    replay engine{xs.data() + xs.size() - n};
+    std::uniform_real_distribution<> unif;
+    for (size_t i = 0; i < n; ++i) {
+      auto const u = unif(engine);
+      EXPECT_EQ(u, us[i]) << xs[xs.size() - n + i];
+      EXPECT_LT(us[i], 1.0);
+    }
+  }
+}
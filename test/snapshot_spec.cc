@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <string>
+#include "gtest/gtest.h"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+#include "wagner/species.hh"
+#include "wagner/speciestree.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/snapshot.hh"
+
+// The content of a w-species file, formatted the synchronous way.
+static auto expected(const wagner::speciestree &tree, size_t t,
+                     wagner::network<wagner::point> const& landscape) -> std::string {
+  std::ostringstream oss;
+  oss << "<extant_species>\n  <t>" << t << "</t>\n";
+  for (auto s : tree) oss << "  " << s->get_info(t, landscape) << '\n';
+  oss << "</extant_species>\n";
+  return oss.str();
+}
+
+static auto slurp(const char *name) -> std::string {
+  std::ifstream in(name);
+  std::ostringstream oss;
+  oss << in.rdbuf();
+  return oss.str();
+}
+
+TEST(WagnerSnapshot, FilesHoldTheTreeAsItWasWhenTaken) {
+  auto rng = std::mt19937_64{42};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(64, 0.25, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 4)};
+  (*tree.begin())->add_to(0);
+
+  size_t const seed = 4242;
+  auto contents = std::vector<std::string>{};
+  {
+    wagner::snapshot_writer writer(landscape, seed);
+    for (size_t t = 1; t <= 64; t *= 2) {
+      for (auto i = 0; i < 5; ++i) {
+        auto parent = *tree.begin();
+        tree.speciate(parent, t)->add_to(landscape.random_vertex(rng));
+      }
+      for (auto sp : tree) {
+        sp->add_to(landscape.random_vertex(rng));
+        sp->up_groups(landscape);
+      }
+      contents.push_back(expected(tree, t, landscape));
+      writer.write(tree, t);
+      // Changing the tree right away does not change what is written.
+      for (auto sp : tree) sp->add_to(landscape.random_vertex(rng));
+    }
+  }
+
+  char name[50];
+  size_t k = 0;
+  for (size_t t = 1; t <= 64; t *= 2, ++k) {
+    std::sprintf(name, "w-species-%lu-t%lu.xml", seed, t);
+    EXPECT_EQ(contents[k], slurp(name));
+    std::remove(name);
+  }
+}
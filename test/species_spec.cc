@@ -0,0 +1,60 @@
+#include <map>
+#include <set>
+#include "gtest/gtest.h"
+#include "wagner/species.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+
+// Component of every location of 's', found from scratch.
+static auto components(wagner::species const& s, wagner::network<wagner::point> const& n)
+    -> std::map<wagner::vertex, int> {
+  std::map<wagner::vertex, int> cs;
+  int c = 0;
+  for (auto v : s.get_locations()) {
+    if (cs.count(v)) continue;
+    auto stack = std::vector<wagner::vertex>{v};
+    cs[v] = c;
+    while (!stack.empty()) {
+      auto const u = stack.back();
+      stack.pop_back();
+      for (auto w : n.neighbors(u)) {
+        if (s.is_in(w) && !cs.count(w)) {
+          cs[w] = c;
+          stack.push_back(w);
+        }
+      }
+    }
+    ++c;
+  }
+  return cs;
+}
+
+TEST(WagnerSpecies, IncrementalGroupsMatchFullLabelling) {
+  auto rng = std::mt19937_64{42};
+  auto net = wagner::network<wagner::point>{};
+  net.rgg(300, 0.09, rng);
+  auto s = wagner::species{0};
+  for (auto step = 0u; step < 200; ++step) {
+    for (auto i = 0u; i < 10; ++i) {
+      auto const v = net.random_vertex(rng);
+      if (rng() % 3 == 0) s.rmv_from(v); else s.add_to(v);
+    }
+    if (step % 20 == 19 && s.up_groups(net) > 0) {
+      s.pop_group(rng() % s.num_groups());
+    }
+    auto const ngroups = s.up_groups(net);
+    auto const cs = components(s, net);
+    auto group_of = std::map<int, int>{}; // Component -> group.
+    for (auto const& c : cs) {
+      auto const g = s.group(c.first);
+      ASSERT_LE(0, g);
+      ASSERT_LT(g, (int)ngroups);
+      auto const it = group_of.insert({c.second, g}).first;
+      ASSERT_EQ(it->second, g);
+    }
+    std::set<int> distinct;
+    for (auto const& cg : group_of) distinct.insert(cg.second);
+    EXPECT_EQ(group_of.size(), distinct.size());
+    EXPECT_EQ(ngroups, distinct.size());
+  }
+}
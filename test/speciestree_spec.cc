@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <vector>
+#include "gtest/gtest.h"
+#include "wagner/speciestree.hh"
+#include "wagner/species.hh"
+#include "wagner/n-sphere.hh"
+#include "wagner/network.hh"
+#include "wagner/point.hh"
+
+TEST(WagnerSpeciesTree, CachedDistancesFollowSpeciation) {
+  auto rng = std::mt19937_64{42};
+  auto noise = std::normal_distribution<float>(0.0f, 0.05f);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 10)};
+  tree.update_distances();
+  for (auto t = 1u; t < 50; ++t) {
+    auto parent = *tree.begin();
+    auto child = tree.speciate(parent, t);
+    EXPECT_EQ(0.0f, tree.distance(*parent, *child));
+    for (auto sp : tree) wagner::white_noise(sp->traits(), rng, noise);
+    tree.update_distances();
+  }
+  for (auto s0 : tree) {
+    for (auto s1 : tree) {
+      EXPECT_EQ(wagner::euclidean_distance(s0->traits(), s1->traits()),
+                tree.distance(*s0, *s1));
+    }
+  }
+}
+
+TEST(WagnerSpeciesTree, TraitsLiveInOneAlignedMatrix) {
+  auto rng = std::mt19937_64{5};
+  auto const init = wagner::random_n_sphere<float>(rng, 5);
+  wagner::speciestree tree{init};
+  EXPECT_TRUE(std::equal(init.begin(), init.end(), (*tree.begin())->begin()));
+  for (auto t = 1u; t < 100; ++t) {
+    auto parent = *tree.begin();
+    (*parent)[t % 5] += 1.0f;
+    auto child = tree.speciate(parent, t); // The matrix grows along the way.
+    EXPECT_TRUE(child->same_traits_as(*parent));
+  }
+  auto &matrix = tree.traits();
+  EXPECT_EQ(5u, matrix.num_traits());
+  EXPECT_EQ(0u, matrix.stride() % 16);
+  for (auto sp : tree) {
+    EXPECT_EQ(matrix.row(sp->slot()), sp->traits().data());
+    EXPECT_EQ(0u, (uintptr_t)sp->traits().data() % 64);
+    EXPECT_EQ(5u, sp->traits().size());
+  }
+}
+
+TEST(WagnerSpeciesTree, BatchedWhiteNoiseMatchesSpeciesBySpecies) {
+  for (auto b : {wagner::boundary::rejection, wagner::boundary::reflect}) {
+    auto rng = std::mt19937_64{9};
+    wagner::speciestree batched{wagner::random_n_sphere<float>(rng, 20, 0.5f, wagner::sampler::direct)};
+    rng.seed(9);
+    wagner::speciestree single{wagner::random_n_sphere<float>(rng, 20, 0.5f, wagner::sampler::direct)};
+    for (auto t = 1u; t < 30; ++t) {
+      batched.speciate(*batched.begin(), t);
+      single.speciate(*single.begin(), t);
+    }
+    auto rng0 = std::mt19937_64{1}, rng1 = rng0;
+    auto d0 = std::normal_distribution<float>(0.0f, 0.1f), d1 = d0;
+    for (auto i = 0; i < 20; ++i) {
+      batched.white_noise(rng0, d0, 0.5f, b);
+      for (auto sp : single) wagner::white_noise(sp->traits(), rng1, d1, 0.5f, b);
+    }
+    auto it = single.begin();
+    for (auto sp : batched) {
+      EXPECT_TRUE(std::equal(sp->begin(), sp->end(), (*it++)->begin()));
+    }
+  }
+}
+
+TEST(WagnerSpeciesTree, MrcaIndexMatchesLineageWalk) {
+  auto rng = std::mt19937_64{7};
+  wagner::speciestree tree{std::vector<float>{}};
+  std::vector<wagner::species*> tips(tree.begin(), tree.end());
+  for (auto t = 1u; t < 300; ++t) {
+    auto parent = tips[rng() % tips.size()];
+    tips.push_back(tree.speciate(parent, t));
+  }
+  for (auto i = 0u; i < 1000; ++i) {
+    auto s0 = tips[rng() % tips.size()], s1 = tips[rng() % tips.size()];
+    if (s0 != s1) {
+      EXPECT_EQ(s0->get_mrca(*s1), tree.mrca(*s0, *s1));
+    }
+  }
+}
+
+TEST(WagnerSpeciesTree, NewickIsWrittenWithoutRecursion) {
+  wagner::speciestree tree{std::vector<float>{}};
+  auto s0 = *tree.begin();
+  EXPECT_EQ("species0:0", tree.newick());
+  auto s1 = tree.speciate(s0, 2);
+  tree.speciate(s1, 5);
+  tree.stop(9);
+  EXPECT_EQ("(species0:7,(species1:4,species2:4):3):0;", tree.newick());
+
+  // A caterpillar deep enough to overflow the stack of a recursive writer.
+  auto tip = s1;
+  for (auto t = 10u; t < 200000; ++t) {
+    tip = tree.speciate(tip, t);
+  }
+  auto const newick = tree.newick();
+  EXPECT_EQ(std::count(newick.begin(), newick.end(), '('),
+            std::count(newick.begin(), newick.end(), ')'));
+  EXPECT_EQ(';', newick.back());
+}
+
+// Subtree aggregates computed from scratch.
+struct aggregates {
+  size_t edges, level, max_end_date;
+};
+
+static auto from_scratch(const wagner::tbranch *t) -> aggregates {
+  if (t->leaf()) return {0, 0, t->end_date()};
+  auto const l = from_scratch(t->left()), r = from_scratch(t->right());
+  return {2 + l.edges + r.edges, 1 + std::max(l.level, r.level),
+          std::max(l.max_end_date, r.max_end_date)};
+}
+
+// Check the cached aggregates of every node against the recursive definitions.
+static auto check_aggregates(std::vector<wagner::species*> const& tips) -> void {
+  const wagner::tbranch *root = tips[0];
+  while (!root->root()) root = root->parent();
+  EXPECT_TRUE(root->strictly_binary());
+  EXPECT_EQ(tips.size(), root->leaves());
+
+  std::vector<const wagner::tbranch*> stack(1, root);
+  while (!stack.empty()) {
+    auto t = stack.back();
+    stack.pop_back();
+    auto const a = from_scratch(t);
+    EXPECT_EQ(a.edges, t->edges());
+    EXPECT_EQ(a.level, t->level());
+    EXPECT_EQ(a.max_end_date, t->max_end_date());
+    if (!t->leaf()) {
+      stack.push_back(t->left());
+      stack.push_back(t->right());
+    }
+  }
+  for (auto s : tips) {
+    size_t distance = 0, nodes = 0;
+    for (const wagner::tbranch *t = s; !t->root(); t = t->parent()) {
+      distance += t->parent_distance();
+      ++nodes;
+    }
+    EXPECT_EQ(distance, s->total_distance());
+    EXPECT_EQ(nodes, s->nodes());
+  }
+}
+
+TEST(WagnerSpeciesTree, CachedAggregatesFollowTheTree) {
+  auto rng = std::mt19937_64{3};
+  wagner::speciestree tree{std::vector<float>{}};
+  std::vector<wagner::species*> tips(tree.begin(), tree.end());
+  tips[0]->add_to(0);
+  for (auto t = 1u; t < 400; ++t) {
+    auto s = tree.speciate(tips[rng() % tips.size()], t);
+    s->add_to(0);
+    tips.push_back(s);
+    if (t % 3 == 0) {
+      auto const i = rng() % tips.size();
+      tips[i]->rmv_from(0);
+      tips[i] = tips.back();
+      tips.pop_back();
+      tree.rmv_extinct(t);
+    }
+    if (t % 50 == 0) {
+      tree.stop(t);
+      check_aggregates(tips);
+    }
+  }
+  check_aggregates(tips);
+}
+
+TEST(WagnerSpeciesTree, ResidentsFollowTheLocationsOfTheSpecies) {
+  auto rng = std::mt19937_64{13};
+  auto landscape = wagner::network<wagner::point>{};
+  landscape.rgg(40, 0.25, rng);
+  wagner::speciestree tree{wagner::random_n_sphere<float>(rng, 3)};
+  for (wagner::vertex v = 0; v < landscape.order(); ++v) {
+    (*tree.begin())->add_to(v);
+  }
+  // The residents of each community are the species found there, by id.
+  auto check_residents = [&] {
+    for (wagner::vertex v = 0; v < landscape.order(); ++v) {
+      auto expected = std::vector<wagner::species*>{};
+      for (auto sp : tree) {
+        if (sp->is_in(v)) {
+          expected.push_back(sp);
+        }
+      }
+      auto const& residents = tree.residents(v);
+      EXPECT_EQ(expected, std::vector<wagner::species*>(residents.begin(), residents.end()));
+    }
+  };
+  check_residents();
+
+  for (size_t t = 1; t <= 40; ++t) {
+    auto tips = std::vector<wagner::species*>(tree.begin(), tree.end());
+    // Colonizations and local extinctions:
+    for (auto sp : tips) {
+      sp->add_to(landscape.random_vertex(rng));
+      auto const& locations = sp->get_locations();
+      sp->rmv_from(locations.nth(rng() % locations.size()));
+    }
+    check_residents();
+    // A group moves to a new species:
+    auto parent = tips[rng() % tips.size()];
+    if (parent->up_groups(landscape) > 0) {
+      auto const group = parent->pop_group(rng() % parent->num_groups());
+      tree.speciate(parent, t)->add_to(group);
+    }
+    check_residents();
+    // Extinct species leave the tree:
+    tree.rmv_extinct(t);
+    check_residents();
+    if (tree.num_species() == 0) {
+      break;
+    }
+  }
+}
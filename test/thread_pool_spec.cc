@@ -0,0 +1,52 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "wagner/thread_pool.hh"
+
+TEST(WagnerThreadPool, RunsEveryTaskOnce) {
+  std::vector<std::atomic<int>> runs(1000);
+  for (auto &r : runs) r = 0;
+  {
+    wagner::thread_pool workers(4);
+    EXPECT_EQ(4u, workers.size());
+    for (size_t i = 0; i < runs.size(); ++i) {
+      workers.submit([&runs, i] { ++runs[i]; });
+    }
+    workers.wait();
+    for (auto &r : runs) EXPECT_EQ(1, r);
+
+    // The workers are reused after a wait.
+    for (size_t i = 0; i < runs.size(); ++i) {
+      workers.submit([&runs, i] { ++runs[i]; });
+    }
+  } // The destructor runs what is left.
+  for (auto &r : runs) EXPECT_EQ(2, r);
+}
+
+TEST(WagnerThreadPool, FreeWorkersTakeTheNextTask) {
+  // One long task must not hold back the short ones queued after it.
+  std::atomic<int> short_done{0};
+  std::atomic<int> short_done_before_long{-1};
+  wagner::thread_pool workers(2);
+  workers.submit([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    short_done_before_long = short_done.load();
+  });
+  for (int i = 0; i < 10; ++i) {
+    workers.submit([&] { ++short_done; });
+  }
+  workers.wait();
+  EXPECT_EQ(10, short_done);
+  EXPECT_EQ(10, short_done_before_long);
+}
+
+TEST(WagnerThreadPool, HasAtLeastOneWorker) {
+  int done = 0;
+  wagner::thread_pool workers(0);
+  EXPECT_EQ(1u, workers.size());
+  workers.submit([&done] { ++done; });
+  workers.wait();
+  EXPECT_EQ(1, done);
+}
@@ -0,0 +1,37 @@
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "wagner/uniforms.hh"
+
+TEST(WagnerUniforms, DrawsAsTheDistributionDoes) {
+  auto rng = std::mt19937_64{3};
+  auto ref = std::mt19937_64{3};
+  std::uniform_real_distribution<> unif;
+  for (size_t block : {1, 7, 256, 312, 1000}) {
+    for (size_t n : {0, 1, 6, 7, 8, 255, 256, 257, 2000}) {
+      {
+        wagner::uniform_buffer draws(rng, block);
+        for (size_t i = 0; i < n; ++i) {
+          EXPECT_EQ(unif(ref), draws());
+        }
+      }
+      // The draws not used are given back: the engines are in the same state.
+      EXPECT_EQ(ref, rng);
+    }
+  }
+}
+
+TEST(WagnerUniforms, GiveBackCanBeCalledAnyTime) {
+  auto rng = std::mt19937_64{5};
+  auto ref = std::mt19937_64{5};
+  std::uniform_real_distribution<> unif;
+  wagner::uniform_buffer draws(rng, 64);
+  for (size_t n : {10, 0, 64, 100}) {
+    for (size_t i = 0; i < n; ++i) draws();
+    draws.give_back();
+    for (size_t i = 0; i < n; ++i) unif(ref);
+    EXPECT_EQ(ref, rng);
+    // The engine can be used in between.
+    EXPECT_EQ(ref(), rng());
+  }
+}